@@ -2,21 +2,44 @@
 #include <cstdint>
 #include <cstring>
 #include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include <thread>
+#include <random>
 
-#include <matrix.hpp>
 #include <offset_array.hpp>
 #include <graph.hpp>
+#include <truss.hpp>
 #include <clq_parser.hpp>
+#include <graph_snapshot.hpp>
+#include <graph_dispatch.hpp>
 #include <bitset.hpp>
-
-typedef LowerTriangularGraph GraphType;
-
-//#define DO_BENCHMARK
-
+#include <bitset_kernels.hpp>
+#include <search_stats.hpp>
+#include <incumbent.hpp>
+#include <work_stealing.hpp>
+#include <anytime.hpp>
+#include <effective_local_search.hpp>
+#include <variable_neighborhood_search.hpp>
+
+// Storage for dense graphs when no --graph flag is given, sparse inputs are stored as a CsrGraph instead.
+// The coloring bound needs full neighbour rows, other layouts get copied into a Graph2D.
+static constexpr GraphLayout defaultLayout = GraphLayout::Matrix;
+
+// Defined by "make bench".
 #ifdef DO_BENCHMARK
-#include <benchmark/benchmark.h>
+#include <benchmark_suite.hpp>
 #endif
 
+// Bounds the search prunes on, in the order of their names in the statistics.
+enum Bound : uint32_t {
+    // The vertices left at this depth cannot make a larger clique
+    CandidateCount,
+    // The vertices left at this depth can be colored with too few colors to hold a larger clique
+    Coloring,
+};
+
 struct Result {
     OffsetArray<uint32_t, 1> best;
     OffsetArray<uint32_t, 1> actNode;
@@ -28,7 +51,8 @@ struct Result {
  * @param g The graph
  * @retval  Upper bound for chromatic number in complementary graph
  */
-uint32_t upperBoundChromaticNumberComplementaryGraph(const GraphType& graph) {
+template<typename G>
+uint32_t upperBoundChromaticNumberComplementaryGraph(const G& graph) {
     OffsetArray<uint32_t, 1> colors { graph.numberOfVertices };
     colors[1] = 1;
     for(uint32_t i = 2; i <= graph.numberOfVertices; ++i) {
@@ -59,147 +83,545 @@ uint32_t upperBoundChromaticNumberComplementaryGraph(const GraphType& graph) {
     return colorsUsed;
 }
 
+/**
+ * @brief   Greedy sequential coloring of the candidates of one depth (as in MCQ/MCS), built one color class at a time
+ *          with bitsets: a class takes the first uncolored vertex, drops its neighbours and repeats.
+ *          The candidates are written out sorted by decreasing color, so the vertex with the highest color is
+ *          expanded first and the color of the next candidate bounds the clique in everything that is left.
+ * @param rows          Full neighbour rows of the graph
+ * @param candidates    The candidates as a bitset over the rows, bit v - 1 for vertex v
+ * @param count         Number of candidates
+ * @param order         Gets the candidates in decreasing color order
+ * @param colors        Gets the color of every candidate in order, colors start at 1
+ * @param uncolored     Scratch bitset of (N + 63) / 64 words
+ * @param colorClass    Scratch bitset of (N + 63) / 64 words
+ */
+void colorCandidates(const Graph2D& rows, const uint64_t* candidates, uint32_t count, uint32_t* order, uint32_t* colors, uint64_t* uncolored, uint64_t* colorClass) {
+    const uint32_t amountOfBitVectors = (rows.numberOfVertices + 64 - 1) / 64;
+
+    std::copy(candidates, candidates + amountOfBitVectors, uncolored);
+
+    uint32_t position = count;
+    for(uint32_t color = 1; position > 0; ++color) {
+        std::copy(uncolored, uncolored + amountOfBitVectors, colorClass);
+
+        for(uint32_t word = 0; word < amountOfBitVectors; ++word) {
+            while(colorClass[word] != 0) {
+                uint32_t vertex = (word << 6UL) + std::countr_zero(colorClass[word]);
+                colorClass[word] &= colorClass[word] - 1;
+                uncolored[word] &= ~(1UL << (vertex & 63UL));
+
+                // Neighbours of this vertex can't share its color.
+                const uint64_t* neighbours = rows.neighbours(vertex + 1);
+                for(uint32_t other = word; other < amountOfBitVectors; ++other) {
+                    colorClass[other] &= ~neighbours[other];
+                }
+
+                --position;
+                order[position] = vertex + 1;
+                colors[position] = color;
+            }
+        }
+    }
+}
+
+/**
+ * @brief   Candidate bitset of the root: every vertex of the graph.
+ */
+std::vector<uint64_t> allVertices(uint32_t N) {
+    std::vector<uint64_t> all((N + 64 - 1) / 64, -1UL);
+    if(N % 64 != 0) {
+        all.back() = (1UL << (N % 64)) - 1;
+    }
+    return all;
+}
+
+typedef Incumbent<std::vector<uint32_t>> CliqueIncumbent;
+
+// Nodes up to this clique size are split into tasks for the other threads, deeper ones are searched in place.
+static constexpr uint32_t splitDepth = 2;
+
+/**
+ * Depth-first branch & bound below one node of the search tree.
+ * Every depth has its candidates as a bitset of N / 64 words, the next depth is one AND with the neighbour row of
+ * the branching vertex. The colored order of the candidates of all depths is kept on one stack.
+ * The sequential search runs one from the root, every worker of the parallel search has its own.
+ */
+class SubtreeSearch {
+public:
+    SubtreeSearch(const Graph2D& rows, CliqueIncumbent& incumbent, SearchStats& stats)
+        : rows(rows), incumbent(incumbent), stats(stats), words((rows.numberOfVertices + 64 - 1) / 64), uncolored(words), colorClass(words) {}
+
+    void color(const uint64_t* candidates, uint32_t count, uint32_t* order, uint32_t* colors) {
+        colorCandidates(rows, candidates, count, order, colors, uncolored.data(), colorClass.data());
+    }
+
+    /**
+     * @brief   Offers a clique to the incumbent.
+     * @param clique    The clique
+     * @param size      Number of vertices in the clique
+     */
+    void offer(const uint32_t* clique, uint32_t size) {
+        // Recorded under the lock of the incumbent, so the improvements of the workers stay in order.
+        incumbent.offer(size, [&](std::vector<uint32_t>& best) {
+            best.assign(clique, clique + size);
+            stats.incumbent(size);
+            std::cout << "Found new best " << size << std::endl;
+        });
+    }
+
+    /**
+     * @brief   Searches every clique that extends the given one with the given candidates.
+     * @param clique        The clique of the node, extended in place while searching
+     * @param candidates    Bitset of the vertices adjacent to the whole clique
+     */
+    void search(std::vector<uint32_t>& clique, const uint64_t* candidates) {
+        const uint32_t prefix = clique.size();
+        uint32_t count = bitset_kernels::count(candidates, words);
+        if(count == 0) {
+            offer(clique.data(), prefix);
+            return;
+        }
+        clique.resize(prefix + count);
+
+        uint32_t depth = 0;
+        sets.resize(words);
+        std::copy(candidates, candidates + words, sets.begin());
+        pushDepth(depth, count);
+
+        while(true) {
+            if(next[depth] == end[depth]) {
+                // Every candidate of this depth is done or pruned, return to the previous depth
+                order.resize(begin[depth]);
+                colors.resize(begin[depth]);
+                if(depth == 0) {
+                    break;
+                }
+                --depth;
+                continue;
+            }
+
+            const uint32_t position = next[depth]++;
+            // The incumbent can be improved by another thread at any time, so it is read again for every candidate.
+            const uint32_t maxClique = incumbent.size();
+            const uint32_t size = prefix + depth;
+            if(size + end[depth] - position <= maxClique) {
+                stats.prune(Bound::CandidateCount);
+                next[depth] = end[depth];
+                continue;
+            }
+            if(size + colors[position] <= maxClique) {
+                // The candidates are sorted by decreasing color, so none of the remaining ones can do better either.
+                stats.prune(Bound::Coloring);
+                next[depth] = end[depth];
+                continue;
+            }
+
+            const uint32_t from = order[position];
+            clique[size] = from;
+            stats.node(size + 1);
+
+            // Only the candidates after this one are left for the next depth, the ones before are done.
+            if(sets.size() < (depth + 2) * words) {
+                sets.resize((depth + 2) * words);
+            }
+            uint64_t* current = &sets[depth * words];
+            current[(from - 1) >> 6UL] &= ~(1UL << ((from - 1) & 63UL));
+            count = bitset_kernels::andIntoCount(current + words, current, rows.neighbours(from), words);
+
+            // If the next depth doesn't contain any nodes, see if a new maxClique has been found
+            if(count == 0) {
+                offer(clique.data(), size + 1);
+                continue;
+            }
+
+            ++depth;
+            pushDepth(depth, count);
+        }
+
+        clique.resize(prefix);
+    }
+
+private:
+    /**
+     * @brief   Colors the candidate set of a depth onto the order stack.
+     */
+    void pushDepth(uint32_t depth, uint32_t count) {
+        if(begin.size() <= depth) {
+            begin.resize(depth + 1);
+            end.resize(depth + 1);
+            next.resize(depth + 1);
+        }
+        begin[depth] = next[depth] = order.size();
+        end[depth] = begin[depth] + count;
+        order.resize(end[depth]);
+        colors.resize(end[depth]);
+        color(&sets[depth * words], count, &order[begin[depth]], &colors[begin[depth]]);
+    }
+
+    const Graph2D& rows;
+    CliqueIncumbent& incumbent;
+    SearchStats& stats;
+    const uint32_t words;
+    std::vector<uint64_t> uncolored;
+    std::vector<uint64_t> colorClass;
+    // Candidate bitset per depth, one after the other.
+    std::vector<uint64_t> sets;
+    // Candidates of all depths in decreasing color order, with their colors. Depth d has [begin[d], end[d])
+    // and continues at next[d].
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> colors;
+    std::vector<uint32_t> begin;
+    std::vector<uint32_t> end;
+    std::vector<uint32_t> next;
+};
+
+/**
+ * A node of the parallel search: a clique and its candidates in decreasing color order.
+ * Its children are tasks, shared by the workers that take them.
+ */
+struct TaskNode {
+    std::vector<uint32_t> clique;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> colors;
+};
+
+// The child of a node that adds its candidate at the given position.
+struct Task {
+    std::shared_ptr<const TaskNode> node;
+    uint32_t position;
+};
+
+/**
+ * @brief   Pushes the children of a node as tasks, the highest color last so the owner takes it first.
+ */
+void pushChildren(WorkStealingPool<Task>& pool, uint32_t worker, std::shared_ptr<const TaskNode> node) {
+    for(uint32_t position = node->candidates.size(); position > 0; --position) {
+        pool.push(worker, { node, position - 1 });
+    }
+}
+
+/**
+ * @brief   Parallel branch & bound: the nodes up to splitDepth become tasks on a work-stealing pool, deeper
+ *          subtrees are searched by the worker that took the task. All workers share one incumbent.
+ */
+void parallelSearch(const Graph2D& rows, CliqueIncumbent& incumbent, SearchStats& stats, uint32_t threads) {
+    const uint32_t N = rows.numberOfVertices;
+    const uint32_t words = (N + 64 - 1) / 64;
+    WorkStealingPool<Task> pool(threads);
+
+    std::vector<SearchStats> workerStats;
+    std::vector<std::unique_ptr<SubtreeSearch>> workers;
+    workerStats.reserve(threads);
+    for(uint32_t worker = 0; worker < threads; ++worker) {
+        workerStats.push_back(stats.fork());
+    }
+    for(uint32_t worker = 0; worker < threads; ++worker) {
+        workers.push_back(std::make_unique<SubtreeSearch>(rows, incumbent, workerStats[worker]));
+    }
+
+    std::vector<uint64_t> all = allVertices(N);
+    auto root = std::make_shared<TaskNode>();
+    root->candidates.resize(N);
+    root->colors.resize(N);
+    workers[0]->color(all.data(), N, root->candidates.data(), root->colors.data());
+    // The children of the root are dealt round robin, so every worker starts with some of the large subtrees.
+    for(uint32_t position = N; position > 0; --position) {
+        pool.push((position - 1) % threads, { root, position - 1 });
+    }
+
+    pool.run([&](uint32_t worker, Task& task) {
+        const TaskNode& node = *task.node;
+        const uint32_t size = node.clique.size();
+        if(size + node.colors[task.position] <= incumbent.size()) {
+            workerStats[worker].prune(Bound::Coloring);
+            return;
+        }
+
+        uint32_t from = node.candidates[task.position];
+        std::vector<uint32_t> clique = node.clique;
+        clique.push_back(from);
+        workerStats[worker].node(size + 1);
+
+        // The candidates after this one in the node, and adjacent to it.
+        std::vector<uint64_t> candidates(words, 0);
+        for(uint32_t i = task.position + 1; i < node.candidates.size(); ++i) {
+            candidates[(node.candidates[i] - 1) >> 6UL] |= 1UL << ((node.candidates[i] - 1) & 63UL);
+        }
+        uint32_t count = bitset_kernels::andIntoCount(candidates.data(), candidates.data(), rows.neighbours(from), words);
+
+        if(clique.size() < splitDepth && count != 0) {
+            auto child = std::make_shared<TaskNode>();
+            child->clique = std::move(clique);
+            child->candidates.resize(count);
+            child->colors.resize(count);
+            workers[worker]->color(candidates.data(), count, child->candidates.data(), child->colors.data());
+            pushChildren(pool, worker, std::move(child));
+        } else {
+            workers[worker]->search(clique, candidates.data());
+        }
+    });
+
+    for(const SearchStats& other : workerStats) {
+        stats.merge(other);
+    }
+}
+
+/**
+ * @brief   Offers a clique found by a heuristic of the portfolio to the incumbent of the exact search.
+ * @param incumbent The incumbent
+ * @param clique    The clique, vertices of the sorted graph
+ * @param heuristic Name of the heuristic for the output
+ * @param stats     Statistics of the heuristic, the improvement is recorded under the lock of the incumbent
+ */
+void publish(CliqueIncumbent& incumbent, const std::vector<uint32_t>& clique, const char* heuristic, SearchStats& stats) {
+    incumbent.offer(clique.size(), [&](std::vector<uint32_t>& best) {
+        best = clique;
+        stats.incumbent(clique.size());
+        std::cout << "Found new best " << clique.size() << " by " << heuristic << std::endl;
+    });
+}
+
+/**
+ * @brief   Effective Local Search for the portfolio: a k-opt local search from every vertex, until all are done or
+ *          the exact search stops it.
+ * @param rows      The sorted graph
+ * @param incumbent Incumbent of the exact search, every better clique is published into it
+ * @param run       Stopped when the exact search is done
+ * @param seed      Seed of the starts
+ * @param stats     Statistics of this thread, forked from those of the exact search
+ */
+void portfolioLocalSearch(const Graph2D& rows, CliqueIncumbent& incumbent, Anytime& run, uint64_t seed, SearchStats& stats) {
+    withBitSet(rows.numberOfVertices + 1, [&](auto type) {
+        typedef typename decltype(type)::type BitSet;
+        const uint32_t N = rows.numberOfVertices;
+        const GraphRows<BitSet> graphRows(rows);
+        BitSetArena arena;
+        std::mt19937 generator;
+        std::vector<uint32_t> clique;
+        for(vertex v = 1; v <= N && !run.expired(); ++v) {
+            BitSetArena::Scope scope(arena);
+            BitSet current{N + 1, arena};
+            const BitSet& found = search_from_vertex(rows, graphRows, v, seed, current, arena, generator, run);
+            if(found.size() > incumbent.size()) {
+                clique.clear();
+                for(vertex u : found) {
+                    clique.push_back(u);
+                }
+                publish(incumbent, clique, "local search", stats);
+            }
+        }
+    });
+}
+
+/**
+ * @brief   One chain of Variable neighborhood search for the portfolio, until it gives up or the exact search stops it.
+ * @param rows      The sorted graph
+ * @param incumbent Incumbent of the exact search, every better clique is published into it
+ * @param run       Stopped when the exact search is done
+ * @param seed      Seed of the chain
+ * @param stats     Statistics of this thread, forked from those of the exact search
+ */
+void portfolioVns(const Graph2D& rows, CliqueIncumbent& incumbent, Anytime& run, uint64_t seed, SearchStats& stats) {
+    const VnsGraph graph(rows);
+    SharedClique shared;
+    VnsRun(graph, shared, run, seed, 0, [&](const Clique& found) {
+        // The chain counts vertices from 0.
+        std::vector<uint32_t> clique;
+        for(Vertex v : found) {
+            clique.push_back(v + 1);
+        }
+        publish(incumbent, clique, "VNS", stats);
+    }).run(0);
+}
+
 /**
  * @brief   Search for the maximum clique using branch & bound
  * @param g The graph
+ * @param stats Statistics of the search tree, only collected when built with SEARCH_STATS
+ * @param threads   Number of threads, 1 runs the sequential search
+ * @param portfolio Also run Effective Local Search and VNS, each on a thread of its own, publishing their cliques
+ *                  into the incumbent. They are stopped when the exact search is done.
  * @retval  A result structure containing the best clique, its size, and the mapping from sorted -> original vertices.
  */
-Result search(GraphType& graph) {
-    const uint32_t N = graph.numberOfVertices;
-
-    OffsetArray<uint32_t, 1> actNode = graph.sortByEdgeDensity(0.40f, std::min_element);
+template<typename G>
+Result search(G& graph, SearchStats& stats, uint32_t threads, bool portfolio) {
+    // Decreasing degree, so the colorings put the vertices with the most neighbours in the first color classes.
+    OffsetArray<uint32_t, 1> actNode = graph.reorder(VertexOrdering::DegreeDescending);
+
+    // A max clique has at least lowerBound vertices, so it lies in the (lowerBound - 1)-core. The vertices outside of
+    // it are dropped before the search, the sorted order of the others is kept. The cheap greedy clique peels first,
+    // so the coloring below runs on what is left, and when that gives a better bound the graph is peeled again.
+    const uint32_t originalVertices = graph.numberOfVertices;
+    CoreReduction reduction(originalVertices);
+    uint32_t lowerBound = greedyCliqueSize(graph);
+    reduction.update(graph, lowerBound);
 
     // The independent set number (alpha) and chromatic number (X) are related as follows:
     //     X >= |V| / alpha(G)
     // <=> alpha(G) >= |V| / X
     // However, the independent set number in the complementary graph is the clique number in the normal graph.
     // Therefore, if we find an upper bound for X in the complementary graph, we can calculate a lower bound as |V|/X.
-    uint32_t greedyColorsInComplement = upperBoundChromaticNumberComplementaryGraph(graph);
-    // Size of the largest currently known clique.
-    // Can be set initially to zero for the initial guess, but we try to guess better.
-    uint32_t maxClique = graph.numberOfVertices / greedyColorsInComplement;
+    if(graph.numberOfVertices > 0) {
+        uint32_t greedyColorsInComplement = upperBoundChromaticNumberComplementaryGraph(graph);
+        lowerBound = std::max(lowerBound, graph.numberOfVertices / greedyColorsInComplement);
+    }
     // Check if the heuristic of Turan is better.
-    if(graph.numberOfVertices * graph.numberOfVertices > 2 * graph.numberOfEdges) {
-        maxClique = std::max(maxClique, graph.numberOfVertices * graph.numberOfVertices / (graph.numberOfVertices * graph.numberOfVertices - 2 * graph.numberOfEdges));
+    // In 64 bits, N² overflows 32 bits from 65536 vertices on.
+    const uint64_t squaredVertices = (uint64_t) graph.numberOfVertices * graph.numberOfVertices;
+    const uint64_t twiceEdges = 2 * (uint64_t) graph.numberOfEdges;
+    if(squaredVertices > twiceEdges) {
+        lowerBound = std::max(lowerBound, (uint32_t) (squaredVertices / (squaredVertices - twiceEdges)));
     }
+    reduction.update(graph, lowerBound);
 
-    std::cout << "Initial lower bound for max clique size: " << maxClique << std::endl;
+    std::cout << "Initial lower bound for max clique size: " << lowerBound << std::endl;
+    if(graph.numberOfVertices < originalVertices) {
+        OffsetArray<uint32_t, 1> kept { graph.numberOfVertices };
+        for(uint32_t i = 1; i <= graph.numberOfVertices; ++i) {
+            kept[i] = actNode[reduction.original(i)];
+        }
+        actNode = std::move(kept);
+        std::cout << "Vertices left in the " << lowerBound - 1 << "-core: " << graph.numberOfVertices << std::endl;
+    }
+    const uint32_t N = graph.numberOfVertices;
 
-    uint32_t currentDepth = 1;
+    // Neighbour rows for the coloring bound.
+    std::unique_ptr<Graph2D> copy;
+    Graph2D* rows;
+    if constexpr(std::is_same_v<G, Graph2D>) {
+        rows = &graph;
+    } else {
+        copy = std::make_unique<Graph2D>();
+        copyToRows(graph, *copy);
+        rows = copy.get();
+    }
 
-    OffsetArray<uint32_t, 1> start { N };
-    OffsetArray<uint32_t, 1> last { N };
-    start[1] = 0;
-    last[1] = N;
-    OffsetArray<uint32_t, 1> best { N };
-    bool storedBest = false;
-
-    ColumnMajorMatrix<uint32_t> adj(N, N);
-    for(uint32_t col = 1; col <= N; ++col) {
-        adj.ref(0, col - 1) = col;
-    }
-    
-    //DynamicBitSet colorsUsed { N + 1 };
-
-    while(currentDepth > 0) {
-        //std::cout << currentDepth << " " << maxClique<<std::endl;
-        ++start[currentDepth];
-
-        if(currentDepth + last[currentDepth] - start[currentDepth] > maxClique || !storedBest) {
-            uint32_t previousDepth = currentDepth;
-            uint32_t from = adj.ref(previousDepth - 1, start[previousDepth] - 1);
-            //colorsUsed.insert(colorMap[from]);
-            ++currentDepth;
-            start[currentDepth] = 0;
-            last[currentDepth] = 0;
-
-            // Determine node for next depth
-            for(uint32_t col = start[previousDepth] + 1, end = last[previousDepth]; col <= end; ++col) {
-                uint32_t to = adj.ref(previousDepth - 1, col - 1);
-
-                if(graph.hasEdge(from, to)/* && !colorsUsed.contains(colorMap[to])*/) {
-                    adj.ref(currentDepth - 1, last[currentDepth]) = to;
-                    ++last[currentDepth];
-                }
-            }
+    // The edges of a max clique lie in at least lowerBound - 2 triangles, the others are peeled off the rows.
+    if(peelTruss(*rows, lowerBound) > 0) {
+        std::cout << "Edges left in the " << lowerBound << "-truss: " << rows->numberOfEdges << std::endl;
+    }
 
-            // If the next depth doesn't contain any nodes, see if a new maxClique has been found and return to previous depth
-            if(last[currentDepth] == 0) {
-                //colorsUsed.erase(colorMap[from]);
-                --currentDepth;
-                if(currentDepth > maxClique || !storedBest) {
-                    maxClique = currentDepth;
-                    for(uint32_t col = 1; col <= currentDepth; ++col) {
-                        best[col] = adj.ref(col - 1, start[col] - 1);
-                    }
-                    storedBest = true;
-                    std::cout << "Found new best " << maxClique << std::endl;
-                }
-            }
-        } else {
-            // Prune, further expansion would not find a better incumbent
-            --currentDepth;
-            if(currentDepth > 0) {
-                //colorsUsed.erase(colorMap[adj.ref(currentDepth - 1, start[currentDepth] - 1)]);
-            }
-        }
+    // Size of the largest clique found so far, shared by all threads.
+    CliqueIncumbent incumbent;
+
+    // The heuristics start on the same sorted graph, so their cliques can go into the incumbent as they are. Each
+    // records its improvements in its own statistics, which are merged once it has been joined.
+    Anytime heuristicsRun(0);
+    std::vector<std::thread> heuristics;
+    SearchStats localSearchStats = stats.fork();
+    SearchStats vnsStats = stats.fork();
+    if(portfolio) {
+        const uint64_t seed = std::random_device{}();
+        heuristics.emplace_back(portfolioLocalSearch, std::cref(*rows), std::ref(incumbent), std::ref(heuristicsRun), seed, std::ref(localSearchStats));
+        heuristics.emplace_back(portfolioVns, std::cref(*rows), std::ref(incumbent), std::ref(heuristicsRun), seed, std::ref(vnsStats));
+    }
+
+    if(threads > 1) {
+        parallelSearch(*rows, incumbent, stats, threads);
+    } else {
+        std::vector<uint32_t> clique;
+        std::vector<uint64_t> all = allVertices(N);
+        SubtreeSearch(*rows, incumbent, stats).search(clique, all.data());
+    }
+    stats.proof();
+
+    heuristicsRun.stop();
+    for(std::thread& heuristic : heuristics) {
+        heuristic.join();
     }
+    stats.merge(localSearchStats);
+    stats.merge(vnsStats);
+
+    OffsetArray<uint32_t, 1> best { N };
+    const std::vector<uint32_t>& clique = incumbent.get();
+    std::copy(clique.begin(), clique.end(), best.ptr());
 
     return {
         .best = std::move(best),
         .actNode = std::move(actNode),
-        .maxClique = maxClique,
+        .maxClique = incumbent.size(),
     };
 }
 
-#ifdef DO_BENCHMARK
+// One instantiation per storage backend, withGraph picks one of them at startup.
+template Result search(Graph2D&, SearchStats&, uint32_t, bool);
+template Result search(LowerTriangularGraph&, SearchStats&, uint32_t, bool);
+template Result search(ListGraph&, SearchStats&, uint32_t, bool);
+template Result search(CsrGraph&, SearchStats&, uint32_t, bool);
 
-static const char* benchFileNames[] = {
-    "test",
-    "/home/niels/Downloads/DSJC500_5.clq",
-};
+#ifdef DO_BENCHMARK
 
-void BM_main(benchmark::State& state) {
-    //std::cout << state.range(0) << std::endl;
-    GraphType graph;
-    ClqParser parser;
-    parser.parse(*benchFileNames[state.range(0)], graph);
-    for(auto _ : state) {
-        benchmark::DoNotOptimize(search(graph));
-    }
+int main(int argc, char* argv[]) {
+    return benchmark_suite::run(argc, argv, { "../../project_2/TestData" }, [] {
+        // Without a given corpus the hard instances (keller5, DSJC1000_5, C250.9, ...) are left out, they take far
+        // longer than a benchmark run.
+        benchmark_suite::registerSolver<Graph2D, ClqParser>("BranchAndBound", [](unsigned) {}, [](Graph2D& graph) {
+            SearchStats stats("BranchAndBound", { "candidateCount", "coloring" });
+            benchmark::DoNotOptimize(search(graph, stats, 1, false));
+        }, { .weighted = false, .maxVertices = 500, .maxDensity = 0.75 });
+    });
 }
-BENCHMARK(BM_main)->Threads(2)->DenseRange(0, sizeof(benchFileNames) / sizeof(benchFileNames[0]), 1);
-
-BENCHMARK_MAIN();
 
 #else
 
 int main(int argc, char* argv[]) {
-    if(argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " [filename]" << std::endl;
+    GraphLayout layout = GraphLayout::Auto;
+    const char* fileName = nullptr;
+    std::string statsFileName;
+    uint32_t threads = 1;
+    bool portfolio = false;
+    try {
+        for(int i = 1; i < argc; ++i) {
+            if(parseGraphLayout(argv[i], layout) || parseStatsFlag(argv[i], statsFileName) || parseThreadsFlag(argv[i], threads)) {
+                continue;
+            }
+            if(strcmp(argv[i], "--portfolio") == 0) {
+                portfolio = true;
+                continue;
+            }
+            if(fileName != nullptr) {
+                throw std::invalid_argument("Too many arguments");
+            }
+            fileName = argv[i];
+        }
+    } catch(std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        fileName = nullptr;
+    }
+    if(fileName == nullptr) {
+        std::cerr << "Usage: " << argv[0] << " [--graph=auto|2d|lower|list|csr] [--stats=<json file>] [--threads=<n>] [--portfolio] [filename]" << std::endl;
         return 1;
     }
 
-    GraphType graph;
     try {
-        ClqParser parser;
-        parser.parse(*argv[1], graph);
-    } catch(std::exception& e) {
-        std::cerr << "Parsing failure: " << e.what() << std::endl;
-        return 2;
-    }
+        return withGraph<ClqParser>(layout, defaultLayout, *fileName, [&](auto& graph) {
+            std::cout << "Graph of " << graph.numberOfVertices << " vertices, " << graph.numberOfEdges << " edges, density " << graph.density() << std::endl;
 
-    std::cout << "Graph of " << graph.numberOfVertices << " vertices, " << graph.numberOfEdges << " edges, density " << graph.density() << std::endl;
+            SearchStats stats("BranchAndBound", { "candidateCount", "coloring" });
+            auto result = search(graph, stats, threads, portfolio);
 
-    auto result = search(graph);
+            std::cout << "Size of max clique: " << result.maxClique << std::endl;
+            for(uint32_t i = 1; i <= result.maxClique; ++i) {
+                std::cout << result.actNode[result.best[i]] << " ";
+            }
+            std::cout << std::endl;
+
+            if(!statsFileName.empty()) {
+                try {
+                    stats.writeJson(statsFileName);
+                } catch(std::exception& e) {
+                    std::cerr << e.what() << std::endl;
+                    return 3;
+                }
+            }
 
-    std::cout << "Size of max clique: " << result.maxClique << std::endl;
-    for(uint32_t i = 1; i <= result.maxClique; ++i) {
-        std::cout << result.actNode[result.best[i]] << " ";
+            return 0;
+        });
+    } catch(std::exception& e) {
+        std::cerr << "Parsing failure: " << e.what() << std::endl;
+        return 2;
     }
-    std::cout << std::endl;
-    
-    return 0;
 }
 
 #endif
@@ -0,0 +1,48 @@
+#!/bin/bash
+# Regression cases with a known max clique size and checks of the search statistics, run with "make check".
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+failed=0
+
+# check <name> <expected size> <clq file>
+check() {
+    size=$(./main "$3" | grep -oE "Size of max clique: [0-9]+" | grep -oE "[0-9]+$")
+    if [ "$size" != "$2" ]; then
+        echo "FAIL $1: expected $2, got ${size:-nothing}"
+        failed=1
+    else
+        echo "ok   $1"
+    fi
+}
+
+# A path of 65537 vertices: N² overflows 32 bits, the Turán bound must still give 2.
+python3 -c "
+n = 65537
+print('p edge', n, n - 1)
+for v in range(1, n):
+    print('e', v, v + 1)
+" > "$dir/path65537.clq"
+check "path of 65537 vertices" 2 "$dir/path65537.clq"
+
+# checkStats <name> <threads> <clq file>: the incumbents of a parallel search are recorded in order of time, so their
+# sizes must increase and the time to best must be that of the last one.
+checkStats() {
+    ./main_stats --threads="$2" --stats="$dir/stats.json" "$3" > /dev/null
+    if python3 -c "
+import json, sys
+stats = json.load(open(sys.argv[1]))
+sizes = [incumbent['value'] for incumbent in stats['incumbents']]
+sys.exit(0 if sizes and sizes == sorted(set(sizes)) and stats['timeToBest'] == stats['incumbents'][-1]['seconds'] else 1)
+" "$dir/stats.json"; then
+        echo "ok   $1"
+    else
+        echo "FAIL $1: incumbents not in order in $(tr -d '\n' < "$dir/stats.json")"
+        failed=1
+    fi
+}
+
+for threads in 2 4 8; do
+    checkStats "statistics of brock200_2 with $threads threads" $threads ../../project_2/TestData/DimacsAdapted_1_20/brock200_2.clq
+done
+
+exit $failed
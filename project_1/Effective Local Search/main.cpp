@@ -2,385 +2,301 @@
 #include <cstdint>
 #include <cstring>
 
-#include <unordered_set>
 #include <algorithm>
+#include <vector>
+#include <bit>
 
 #include <clq_parser.hpp>
+#include <graph_snapshot.hpp>
+#include <graph_dispatch.hpp>
 #include <graph.hpp>
 #include <offset_array.hpp>
 #include <bitset.hpp>
-#include <vector>
+#include <bitset_arena.hpp>
+#include <fixed_bitset.hpp>
+#include <work_stealing.hpp>
+#include <flags.hpp>
+#include <anytime.hpp>
+#include <effective_local_search.hpp>
+#include <truss.hpp>
 
 #include <random>
-#include <chrono> 
-
-using namespace std::chrono; 
+#include <atomic>
+#include <thread>
+#include <functional>
 
-typedef uint32_t vertex;
+// Defined by "make bench".
+#ifdef DO_BENCHMARK
+#include <benchmark_suite.hpp>
+#endif
 
-typedef LowerTriangularGraph GraphType;
+// Storage for dense graphs when no --graph flag is given, sparse inputs are stored as a CsrGraph instead.
+static constexpr GraphLayout defaultLayout = GraphLayout::LowerTriangular;
 
-std::random_device device;
-std::mt19937 generator(device());
-
-// For each vertex this list contains the vertices in the Graph it is NOT connected to.
-OffsetArray<std::vector<vertex>, 1> missing_connections;
+/**
+ * Command line options of the multi start search.
+ */
+struct SearchOptions
+{
+    // Number of threads the starts are spread over
+    uint32_t threads = 1;
+    // Seed every start derives its random stream from
+    uint64_t seed = 0;
+    // Stop once a clique of this size is found, 0 runs all starts
+    uint32_t target = 0;
+    // Stop once this many milliseconds have passed, 0 runs without a budget
+    uint64_t budgetMs = 0;
+    // Peel the graph again once the best clique grew by this many vertices, 0 never peels
+    uint32_t core_threshold = 1;
+};
+
+// With peeling, the starts run in rounds of this many, the graph is only peeled in between.
+static constexpr uint32_t starts_per_round = 64;
 
 /**
- * @brief  Single step update of the intermeidiate data structures after a single one-opt add or drop move
- * @note   
- * @param  g: the graph
- * @param  v: vertex being added or removed from clique
- * @param  is_add: Is the vertex being added?
- * @param  possible_additions: Set of all nodes that can be added
- * @param  one_missing: Set of all nodes missing a single other edge with the clique in order to be possible additions
- * @param  missing_list: List of sets containing for each node the edges they are missing with the clique as to be added (these edges are specified as the vertex in the clique they contain)
- * @param  degree_PA: The degree of each node in the Graph induced by Possible Additions.
- * @retval None
+ * @brief  Multi start local search, one k-opt local search from every vertex, spread over the threads
+ * @note   Every start draws from its own random stream, derived from the seed and the start vertex, and ties between
+ *         equally large cliques go to the lowest start vertex. So a seed gives the same clique for any number of
+ *         threads, unless the target stops the run early.
+ * @note   A larger clique than the best one lies in the core of the best size and in the truss of one more, so
+ *         between rounds of starts the graph is peeled to those whenever the best clique grew by the core threshold.
+ *         The starts that are left are the ones in the core, and every later start works on smaller sets.
+ * @param  graph: The graph, gets peeled
+ * @param  options: Threads, seed, target, budget and core threshold
+ * @param  anytime: Budget of the run and report of the best clique so far
+ * @retval Exit code
  */
-void incremental_update(const GraphType &g, vertex v, bool is_add, DynamicBitSet &possible_additions, DynamicBitSet &one_missing, OffsetArray<std::unordered_set<vertex>, 1> &missing_list, OffsetArray<uint32_t, 1> &degree_PA)
+template <typename BitSet, typename G>
+int multi_start_search(G &graph, const SearchOptions &options, Anytime &anytime)
 {
-    if (is_add)
-    {
-        possible_additions.erase(v);
-        one_missing.insert(v);
-        missing_list[v].insert(v);
+    const uint32_t N = graph.numberOfVertices;
 
-        // Find all vertices missing a connection with v
-        for (vertex j : missing_connections[v])
-        {
-            // Add these to the set keeping track of the vertices from CC j isn't connected to
-            missing_list[j].insert(v);
+    std::cout << "Graph of " << N << " vertices, " << graph.numberOfEdges << " edges, density " << graph.density() << std::endl;
+    std::cout << "Seed: " << options.seed << std::endl;
 
-            // If one edge is missing now it should be added to one_missing
-            // And Also remove from possible additions
-            if (missing_list[j].size() == 1)
-            {
-                possible_additions.erase(j);
+    CoreReduction reduction(N, options.core_threshold);
+    GraphRows<BitSet> rows(graph);
+
+    // The best clique and the start it came from, as vertices of the original graph
+    std::vector<vertex> best_clique;
+    vertex best_start = 0;
 
-                // Update the degrees in possible additions
-                for (vertex v : possible_additions)
+    std::atomic<bool> target_reached = false;
+    std::atomic<uint32_t> starts_done = 0;
+
+    // Everything a thread changes, the best clique of its own starts in the round included
+    struct ThreadContext
+    {
+        BitSetArena arena;
+        std::mt19937 generator;
+        BitSet best_clique;
+        vertex best_start = 0;
+    };
+    std::vector<ThreadContext> contexts(options.threads);
+
+    // First start of the next round, as a vertex of the current graph
+    vertex round_begin = 1;
+    while (round_begin <= graph.numberOfVertices && !target_reached.load() && (starts_done.load() == 0 || !anytime.expired()))
+    {
+        const uint32_t n = graph.numberOfVertices;
+        const vertex round_end = options.core_threshold == 0 ? n : std::min(n, round_begin + starts_per_round - 1);
+
+        // Starts are handed out in order, a thread takes the next one when it is done with one.
+        // The first start always runs, so even a budget that is gone before the search begins gives a clique.
+        std::atomic<vertex> next_start = round_begin;
+        auto work = [&](ThreadContext &context) {
+            context.best_clique = BitSet{n + 1};
+            context.best_start = 0;
+            for (vertex v = next_start++; v <= round_end && !target_reached.load(std::memory_order_relaxed) && ((best_clique.empty() && v == round_begin) || !anytime.expired()); v = next_start++)
+            {
+                // Take a single vertex from the vertices in G
+                // Construct a Set of all connected neighbours in PA
+                // The other vertices as well as the chosen vertex v are then part of the set OM (one missing)
+                BitSetArena::Scope scope(context.arena);
+                BitSet current_clique{n + 1, context.arena};
+                const BitSet &clique = search_from_vertex(graph, rows, v, options.seed, current_clique, context.arena, context.generator, anytime);
+
+                // The starts of a thread only go up, so a tie keeps the lower start.
+                if (clique.size() > context.best_clique.size())
                 {
-                    if (j != v && g.hasEdge(j, v))
-                    {
-                        degree_PA[v]--;
-                    }
+                    context.best_clique = clique;
+                    context.best_start = v;
+                    anytime.improve(clique.size());
+                }
+                starts_done++;
+                if (options.target > 0 && clique.size() >= options.target)
+                {
+                    target_reached.store(true, std::memory_order_relaxed);
                 }
-                one_missing.insert(j);
-            }
-            // If two edges are missing now, we remove it from one_missing
-            else if (missing_list[j].size() == 2)
-            {
-                one_missing.erase(j);
             }
-        }
-    }
-    else
-    {
-        possible_additions.insert(v);
-        one_missing.erase(v);
-        missing_list[v].erase(v);
+        };
 
-        // Find all vertices missing a connection with v
-        for (vertex j : missing_connections[v])
+        std::vector<std::thread> workers;
+        for (uint32_t thread = 1; thread < options.threads; thread++)
+        {
+            workers.emplace_back(work, std::ref(contexts[thread]));
+        }
+        work(contexts[0]);
+        for (std::thread &worker : workers)
         {
-            // Remove this vertex v from the set keeping track of vertices from CC j isn't connected to
-            missing_list[j].erase(v);
+            worker.join();
+        }
 
-            // If no vertices from CC are not connected to j, it becomes a possible addition
-            if (missing_list[j].size() == 0)
+        // The rounds only go up as well, so a tie with an earlier round keeps the clique of that round.
+        for (const ThreadContext &context : contexts)
+        {
+            const size_t size = context.best_clique.size();
+            const vertex start = context.best_start == 0 ? 0 : reduction.original(context.best_start);
+            if (size > best_clique.size() || (size == best_clique.size() && size > 0 && start < best_start))
             {
-                one_missing.erase(j);
-                possible_additions.insert(j);
-                for (vertex v : possible_additions)
+                best_clique.clear();
+                for (vertex i : context.best_clique)
                 {
-                    if (j != v && g.hasEdge(j, v))
-                    {
-                        degree_PA[v]++;
-                    }
+                    best_clique.push_back(reduction.original(i));
                 }
-            }
-            // If only one edge is missing, add to one_missing
-            else if (missing_list[j].size() == 1)
-            {
-                one_missing.insert(j);
+                best_start = start;
             }
         }
-    }
-}
 
-/**
- * @brief  This method will recompute the provided auxiliary data structures for a given clique
- * @note   
- * @param  graph: Current graph
- * @param  current_clique: Current clique
- * @param  possible_additions: Set of all nodes that can be added
- * @param  one_missing: Set of all nodes missing a single other edge with the clique in order to be possible additions
- * @param  missing_list: List of sets containing for each node the edges they are missing with the clique as to be added (these edges are specified as the vertex in the clique they contain)
- * @param  degree_PA: The degree of each node in the Graph induced by Possible Additions.
- * @retval None
- */
-void recompute_auxiliary_sets(const GraphType &graph, DynamicBitSet &current_clique, DynamicBitSet &possible_additions, DynamicBitSet &one_missing, OffsetArray<std::unordered_set<vertex>, 1> &missing_list, OffsetArray<uint32_t, 1> &degree_PA)
-{
-    possible_additions.clear();
-    one_missing.clear();
-
-    for (vertex v = 1; v <= graph.numberOfVertices; v++)
-    {
-        missing_list[v].clear();
-        degree_PA[v] = 0;
-    }
-
-    // We'll now construct the missing_list:
-    // For each of the vertices in the current clique we add them to the missing_list
-
-    for (vertex v : current_clique)
-    {
-        missing_list[v].insert(v);
-        for (vertex n : missing_connections[v])
+        round_begin = round_end + 1;
+        const vertex last_start = reduction.original(round_end);
+        const uint32_t size = best_clique.size() + 1;
+        if (round_begin > n || !reduction.due(size))
         {
-            missing_list[n].insert(v);
+            continue;
         }
-    }
 
-    // For each of the vertices in the missing list, check if they are missing 0 or 1 vertices with the current clique
-    for (vertex v = 1; v <= graph.numberOfVertices; v++)
-    {
-        uint32_t size = missing_list[v].size();
-        if (size == 0)
+        // A larger clique also lies in the truss of its size. Its edges are peeled first, the vertices that lose them
+        // drop out of the core as well.
+        Graph2D truss;
+        copyToRows(graph, truss);
+        bool peeled = false;
+        if (peelTruss(truss, size) > 0)
         {
-            possible_additions.insert(v);
+            std::vector<std::pair<vertex, vertex>> outside;
+            graph.forEachEdge([&](uint32_t from, uint32_t to) {
+                if (!truss.hasEdge(from + 1, to + 1))
+                    outside.emplace_back(from + 1, to + 1);
+            });
+            for (auto [from, to] : outside)
+            {
+                graph.removeEdge(from, to);
+            }
+            graph.numberOfEdges = truss.numberOfEdges;
+            std::cout << "Edges left in the " << size << "-truss: " << graph.numberOfEdges << std::endl;
+            peeled = true;
         }
-        else if (size == 1)
+        if (reduction.update(graph, size))
         {
-            one_missing.insert(v);
+            std::cout << "Vertices left in the " << size - 1 << "-core: " << graph.numberOfVertices << std::endl;
+            peeled = true;
         }
-    }
+        if (!peeled)
+        {
+            continue;
+        }
+        rows = GraphRows<BitSet>(graph);
 
-    // Finally we determine the degree in possible additions
-    for (vertex v : possible_additions)
-    {
-        for (vertex n : possible_additions)
+        // The peel keeps the order of the vertices, so the starts left are the ones after the last start of the round.
+        round_begin = 1;
+        while (round_begin <= graph.numberOfVertices && reduction.original(round_begin) <= last_start)
         {
-            if (n != v && graph.hasEdge(n, v))
-            {
-                degree_PA[v]++;
-            }
+            round_begin++;
         }
     }
+
+    if (anytime.expired())
+    {
+        std::cout << "Budget of " << options.budgetMs << " ms used up after " << starts_done.load() << " of " << N << " starts" << std::endl;
+    }
+    std::cout << "Size of max clique: " << best_clique.size() << std::endl;
+    std::cout << "Found after: " << anytime.timeToBest() << " s" << std::endl;
+    for (vertex i : best_clique)
+    {
+        std::cout << i << " ";
+    }
+    std::cout << std::endl;
+
+    return 0;
 }
 
 /**
- * @brief  Performs the actual k-opt-local search algorithm
- * @note   
- * @param  graph: Graph used during the search
- * @param  current_clique: Starting clique
- * @param  possible_additions: Possible additions to the current clique (i.e. nodes connected to all nodes in the current_clique)
- * @param  one_missing: Nodes missing exactly one edge with the current_clique
- * @param  missing_list: This is an array of N sets (N = number of vertices), a set at position j contains the nodes in current_clique vertex j+1 in the graph is not connected to
- * @param  degree_PA: This list will, for each node in the graph, hold the degree of that node in the graph induced by the edges of possible_additions
- * @retval A resulting clique form the k_opt_local_search
+ * @brief  Picks the bitset type once from the amount of vertices and runs the search with it
+ * @param  graph: The graph, gets peeled
+ * @param  options: Threads, seed, target, budget and core threshold
+ * @param  anytime: Budget of the run and report of the best clique so far
+ * @retval Exit code
  */
-DynamicBitSet &k_opt_local_search(const GraphType &graph, DynamicBitSet &current_clique, DynamicBitSet &possible_additions, DynamicBitSet &one_missing, OffsetArray<std::unordered_set<vertex>, 1> &missing_list, OffsetArray<uint32_t, 1> &degree_PA)
+template <typename G>
+int solve(G &graph, const SearchOptions &options, Anytime &anytime)
 {
-    std::uniform_int_distribution<int> distribution(1, graph.numberOfVertices);
-
-    int g = 0;
-    int g_max = 0;
-
-    // p = {1, .., n}
-    DynamicBitSet p{graph.numberOfVertices + 1};
-
-    do
-    {
-        p = DynamicBitSet{graph.numberOfVertices + 1};
-        p.fill();
-        p.erase(0);
-        g = 0;
-        g_max = 0;
-
-        DynamicBitSet previous_clique = current_clique;
-        DynamicBitSet d = previous_clique;
-
-        DynamicBitSet best_clique;
-
-        while (!d.empty())
-        {
-            DynamicBitSet intersect = possible_additions.intersectionWith(p);
-            vertex m;
-            // if |PA /\ P| > 0
-            if (!intersect.empty())
-            { // ADD PHASE
-
-                // Find the v in PA_i_P with maximum induced_degree(graph, PA, v)
-                std::vector<vertex> max_degree;
-                uint32_t maximum = 0;
-                for (vertex v : intersect)
-                {
-                    if (degree_PA[v] == maximum)
-                    {
-                        max_degree.push_back(v);
-                    }
-                    else if (degree_PA[v] > maximum)
-                    {
-                        maximum = degree_PA[v];
-                        max_degree.clear();
-                        max_degree.push_back(v);
-                    }
-                }
-                // Randomly choose vertex with maximum degree
-                int rnd = distribution(generator) % max_degree.size();
-                m = max_degree[rnd];
-
-                current_clique.insert(m);
-                g++;
-                p.erase(m);
-
-                if (g > g_max)
-                {
-                    g_max = g;
-                    best_clique = current_clique;
-                }
-            }
-            else
-            { // DROP PHASE
-
-                // find a v in the intersection of CC and P so that |PA| is maximum, i.e. the v that most commonly occurs in the Missing map's entries for One Missing items
-                DynamicBitSet CC_i_P = current_clique.intersectionWith(p);
-
-                uint32_t maximum = 0;
-                std::vector<vertex> max_occurence;
+    // Sets of up to 16 words are stored inline, larger graphs use DynamicBitSet.
+    return withBitSet(graph.numberOfVertices + 1, [&](auto type) { return multi_start_search<typename decltype(type)::type>(graph, options, anytime); });
+}
 
-                for (vertex v : CC_i_P)
-                {
-                    uint32_t frequency = 0;
-                    for (vertex m : one_missing)
-                    {
-                        frequency += missing_list[m].count(v);
-                    }
-                    if (frequency == maximum)
-                    {
-                        max_occurence.push_back(v);
-                    }
-                    else if (frequency > maximum)
-                    {
-                        max_occurence.clear();
-                        max_occurence.push_back(v);
-                        maximum = frequency;
-                    }
-                }
-                // if multiple vertices, choose one randomly
-                int rnd = distribution(generator) % max_occurence.size();
-                m = max_occurence[rnd];
+// One instantiation per storage backend, withGraph picks one of them at startup.
+template int solve(Graph2D &, const SearchOptions &, Anytime &);
+template int solve(LowerTriangularGraph &, const SearchOptions &, Anytime &);
+template int solve(ListGraph &, const SearchOptions &, Anytime &);
+template int solve(CsrGraph &, const SearchOptions &, Anytime &);
 
-                current_clique.erase(m);
-                g--;
-                p.erase(m);
+#ifdef DO_BENCHMARK
 
-                if (previous_clique.contains(m))
-                {
-                    d.erase(m);
-                }
-            }
-            incremental_update(graph, m, !intersect.empty(), possible_additions, one_missing, missing_list, degree_PA);
-        }
-        // Note: When reusing the sets best_clique and previous_clique auxiliary sets have to be recomputed, or stored somewhere temporarily
-        if (g_max > 0)
-        {
-            current_clique = std::move(best_clique);
-        }
-        else
-        {
-            current_clique = std::move(previous_clique);
-        }
-        recompute_auxiliary_sets(graph, current_clique, possible_additions, one_missing, missing_list, degree_PA);
-    } while (g_max > 0);
-    return current_clique;
+int main(int argc, char *argv[])
+{
+    static SearchOptions options;
+    return benchmark_suite::run(argc, argv, {"../../project_2/TestData"}, [] {
+        benchmark_suite::registerSolver<LowerTriangularGraph, ClqParser>("EffectiveLocalSearch", [](unsigned seed) { options.seed = seed; }, [](LowerTriangularGraph &graph) {
+            Anytime anytime(options.budgetMs);
+            benchmark::DoNotOptimize(solve(graph, options, anytime));
+        }, {.weighted = false});
+    });
 }
 
+#else
+
 /**
  * @brief  The main method implementing a multi start local search
  */
 int main(int argc, char *argv[])
 {
-    srand((unsigned)time(0));
-    if (argc != 2)
-    {
-        std::cerr << "Usage: " << argv[0] << " [filename]" << std::endl;
-        return 1;
-    }
-
-    GraphType graph;
+    GraphLayout layout = GraphLayout::Auto;
+    SearchOptions options;
+    options.seed = std::random_device{}();
+    const char *fileName = nullptr;
     try
     {
-        ClqParser parser;
-        parser.parse(*argv[1], graph);
+        for (int i = 1; i < argc; i++)
+        {
+            if (parseGraphLayout(argv[i], layout) || parseThreadsFlag(argv[i], options.threads) || parseNumberFlag(argv[i], "--seed=", options.seed) || parseNumberFlag(argv[i], "--target=", options.target) || parseNumberFlag(argv[i], "--budget-ms=", options.budgetMs) || parseNumberFlag(argv[i], "--core-threshold=", options.core_threshold))
+                continue;
+            if (fileName != nullptr)
+                throw std::invalid_argument("Too many arguments");
+            fileName = argv[i];
+        }
     }
     catch (std::exception &e)
     {
-        std::cerr << "Parsing failure: " << e.what() << std::endl;
-        return 2;
+        std::cerr << e.what() << std::endl;
+        fileName = nullptr;
     }
-
-    const uint32_t N = graph.numberOfVertices;
-
-    std::cout << "Graph of " << N << " vertices, " << graph.numberOfEdges << " edges, density " << graph.density() << std::endl;
-
-    // Take a single vertex from the vertices in G
-    // Construct a Set of all connected neighbours in PA
-    // The other vertices as well as the chosen vertex v are then part of the set OM (one missing)
-    DynamicBitSet best_clique{N + 1};
-    //uint64_t sizes {0};
-    //uint64_t runtimes {0};
-
-    missing_connections = OffsetArray<std::vector<vertex>, 1>(N);
-
-    // Determine in advance for each node what vertices it is NOT connected to
-    for (vertex v = 1; v <= N; v++)
+    if (fileName == nullptr)
     {
-        for (vertex o = 1; o < v; o++)
-        {
-            if (!graph.hasEdge(v, o))
-            {
-                missing_connections[v].push_back(o);
-                missing_connections[o].push_back(v);
-            }
-        }
+        std::cerr << "Usage: " << argv[0] << " [--graph=auto|2d|lower|list|csr] [--threads=<n>] [--seed=<n>] [--target=<size>] [--budget-ms=<n>] [--core-threshold=<n>] [filename]" << std::endl;
+        return 1;
     }
 
-    for (vertex v = 1; v <= N; v++)
+    try
     {
-        //auto start = high_resolution_clock::now(); 
-        DynamicBitSet current_clique{N + 1};
-        current_clique.insert(v);
-
-        DynamicBitSet possible_additions{N + 1};
-        OffsetArray<std::unordered_set<vertex>, 1> missing_list{N};
-        OffsetArray<uint32_t, 1> degree_PA{N};
-        DynamicBitSet one_missing{N + 1};
-
-        recompute_auxiliary_sets(graph, current_clique, possible_additions, one_missing, missing_list, degree_PA);
-        DynamicBitSet clique = k_opt_local_search(graph, current_clique, possible_additions, one_missing, missing_list, degree_PA);
-        //auto stop = high_resolution_clock::now(); 
-
-
-        //sizes += clique.size();
-        //runtimes += duration_cast<microseconds>(stop - start).count();
-
-        if (clique.size() > best_clique.size())
-        {
-            best_clique = std::move(clique);
-        }
+        // The budget includes reading the graph.
+        Anytime anytime(options.budgetMs);
+        return withGraph<ClqParser>(layout, defaultLayout, *fileName, [&](auto &graph) { return solve(graph, options, anytime); });
     }
-
-    // std::cout << "Average runtime of k-opt: " << ((double)runtimes/(double)N)*1E-6 << std::endl;
-    // std::cout << "Size of avg clique: " << ((double)sizes/(double)N) << std::endl;
-    std::cout << "Size of max clique: " << best_clique.size() << std::endl;
-    for (vertex i : best_clique)
+    catch (std::exception &e)
     {
-        std::cout << i << " ";
+        std::cerr << "Parsing failure: " << e.what() << std::endl;
+        return 2;
     }
-    std::cout << std::endl;
-
-    return 0;
 }
+
+#endif
@@ -1,137 +1,448 @@
 #include <iostream>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <string>
+#include <stdexcept>
 
 #include <graph.hpp>
+#include <truss.hpp>
 #include <clq_parser.hpp>
+#include <graph_snapshot.hpp>
 #include <offset_array.hpp>
 #include <bitset.hpp>
+#include <bitset_kernels.hpp>
+#include <search_stats.hpp>
+#include <incumbent.hpp>
+#include <work_stealing.hpp>
+#include <flags.hpp>
 
-void clique(const Graph2D &graph, OffsetArray<uint64_t, 1> &activeNodes, const uint64_t* neighbours, uint32_t size, DynamicBitSet &maxClique, DynamicBitSet &tempClique, uint32_t &maxCliqueSize, bool &found, OffsetArray<uint32_t, 1> &c) {
-    uint32_t amountOfBitVectors = (graph.numberOfVertices + 64 - 1) / 64;
-    
-    // calculate intersection between activeNodes and neighbours
-    OffsetArray<uint64_t, 1> nextActiveNodes { amountOfBitVectors };
-    for(uint32_t j = 1; j <= amountOfBitVectors; ++j) {
-        nextActiveNodes[j] = activeNodes[j] & neighbours[j - 1];
-    }
-    
-    // Calculate size of current graph
-    uint32_t graphSize = 0;
-    for(uint32_t j = 1; j <= amountOfBitVectors; ++j) {
-        graphSize += std::__popcount(nextActiveNodes[j]);
+// Defined by "make bench".
+#ifdef DO_BENCHMARK
+#include <benchmark_suite.hpp>
+#endif
+
+// Bounds the search prunes on, in the order of their names in the statistics.
+enum Bound : uint32_t {
+    // Not enough candidates left to beat the best clique
+    CandidateCount,
+    // c[i], the largest clique among the vertices up to i, is too small
+    RussianDoll,
+    // The active nodes can be colored with too few colors, only checked up to the color depth
+    Coloring,
+};
+
+// Depths below this one also bound with a greedy coloring of their active nodes when no --color-depth is given.
+static constexpr uint32_t defaultColorDepth = 8;
+
+struct Result {
+    DynamicBitSet maxClique;
+    OffsetArray<uint32_t, 1> actNode;
+    uint32_t maxCliqueSize;
+};
+
+typedef Incumbent<DynamicBitSet> CliqueIncumbent;
+
+/**
+ * The c[] array of Ostergard, shared by the threads: c[i] is an upper bound on the largest clique among the
+ * vertices 1..i. Sequentially c[i] is exact once subproblem i is done. In parallel, subproblem i can finish before
+ * i - 1, so a finished entry is combined with the bound before it, and an unfinished entry is c[i - 1] + 1.
+ * Every finish tightens the entries after it. Reading an entry is a plain load.
+ */
+class CliqueBounds final {
+public:
+    CliqueBounds(uint32_t N) : bounds(new std::atomic<uint32_t>[N + 1]), best(N + 1, 0), done(N + 1, false) {
+        // Nothing is done yet: at most one vertex more for every vertex.
+        for(uint32_t i = 0; i <= N; ++i) {
+            bounds[i].store(i, std::memory_order_relaxed);
+        }
+        done[0] = true;
     }
-    
-    if(graphSize == 0) {
-        if(size > maxCliqueSize) {
-            maxCliqueSize = size;
-            maxClique = tempClique; // Copies
-            found = true;
-        }
-        return;
+
+    inline uint32_t operator[](uint32_t i) const {
+        return bounds[i].load(std::memory_order_relaxed);
     }
 
-    // While the graph is not empty
-    while(graphSize != 0) {
-        if(size + graphSize <= maxCliqueSize) 
-            return;
+    /**
+     * @brief   Publishes that subproblem i is done: no clique with i as largest vertex beats maxCliqueSize.
+     * @param i             The subproblem
+     * @param maxCliqueSize The incumbent when it finished
+     */
+    void finish(uint32_t i, uint32_t maxCliqueSize) {
+        std::lock_guard<std::mutex> lock(mutex);
+        done[i] = true;
+        best[i] = maxCliqueSize;
 
-        // Find the position of the lowest node (in our case the last set bit)
-        uint32_t i = 1;
-        for(uint32_t j = amountOfBitVectors; j > 0; --j) {
-            if(nextActiveNodes[j] != 0) {
-                i = ((j - 1) * 64) + 64 - std::__countl_zero(nextActiveNodes[j]);
+        for(uint32_t j = i; j < best.size(); ++j) {
+            uint32_t previous = bounds[j - 1].load(std::memory_order_relaxed);
+            uint32_t bound = done[j] ? std::min(previous + 1, std::max(previous, best[j])) : previous + 1;
+            // Entries after an unchanged one don't change either.
+            if(j > i && bound == bounds[j].load(std::memory_order_relaxed)) {
                 break;
             }
+            bounds[j].store(bound, std::memory_order_relaxed);
         }
+    }
 
-        if(size + c[i] <= maxCliqueSize)
-            return;
+private:
+    std::unique_ptr<std::atomic<uint32_t>[]> bounds;
+    std::vector<uint32_t> best;
+    std::vector<bool> done;
+    std::mutex mutex;
+};
 
-        tempClique.insert(i);
+/**
+ * Iterative search of Ostergard's subproblems, one per thread.
+ * Depth d has its active nodes as a bitset in a preallocated stack, with the number of set bits and the number of
+ * words up to the highest non-zero one. Taking a vertex only lowers the count, and the search for the last set bit
+ * starts at the highest non-zero word, so the only full passes over a row are the ANDs that make the next depth.
+ *
+ * Depths below colorDepth also color their active nodes greedily when they are made. The number of colors bounds
+ * the clique in every subset of them, so it stays valid while vertices are taken, and the search prunes on the
+ * minimum of that and c[i]. Coloring costs a pass over the rows of all active nodes, so deep in the tree, where
+ * the sets are small and there are many of them, only the c[] check is done.
+ */
+class SubproblemSearch {
+public:
+    SubproblemSearch(const Graph2D& graph, const CliqueBounds& c, CliqueIncumbent& incumbent, SearchStats& stats, uint32_t colorDepth)
+        : graph(graph), c(c), incumbent(incumbent), stats(stats), colorDepth(colorDepth), words((graph.numberOfVertices + 64 - 1) / 64),
+          uncolored(words), colorClass(words) {}
 
-        // Remove node
-        nextActiveNodes[((i - 1) / 64) + 1] &= ~(1UL << ((i - 1) & 63UL));
+    /**
+     * @brief   Searches the cliques with root as largest vertex, stops early once it finds one larger than c[root - 1].
+     * @param root  The vertex of the subproblem
+     */
+    void search(uint32_t root) {
+        const uint64_t* neighbours = graph.neighbours(root);
+        clique.resize(1);
+        clique[0] = root;
+        stats.node(1);
 
-        auto newNeighbours = graph.neighbours(i);
-        clique(graph, nextActiveNodes, newNeighbours, size + 1, maxClique, tempClique, maxCliqueSize, found, c);
+        // Subproblem root: the active nodes are 1..root-1 and its neighbours.
+        reserve(0);
+        uint32_t top = std::min(words, (root - 1 + 64 - 1) / 64);
+        for(uint32_t j = 0; j < top; ++j) {
+            uint64_t active = root - 1 >= (j + 1) * 64 ? UINT64_MAX : UINT64_MAX >> (64 - (root - 1 - j * 64));
+            sets[j] = active & neighbours[j];
+        }
+        levels[0] = { (uint32_t) bitset_kernels::count(sets.data(), top), top, noColorBound };
+        if(colorDepth > 0) {
+            levels[0].colors = countColors(sets.data(), top, 1);
+        }
 
-        if(found)
+        if(levels[0].graphSize == 0) {
+            offer(1);
             return;
+        }
+
+        uint32_t depth = 0;
+        while(true) {
+            // Room for the next depth first, growing the stack moves it.
+            reserve(depth + 1);
+            Level& level = levels[depth];
+            uint64_t* activeNodes = &sets[(size_t) depth * words];
+            // The size of the clique without the vertex that is picked at this depth
+            const uint32_t size = depth + 1;
+            // Another thread can find a larger clique at any time.
+            const uint32_t maxCliqueSize = incumbent.size();
+
+            bool done = level.graphSize == 0;
+            if(!done && size + level.graphSize <= maxCliqueSize) {
+                stats.prune(Bound::CandidateCount);
+                done = true;
+            }
+
+            uint32_t i = 0;
+            if(!done) {
+                // Find the position of the lowest node (in our case the last set bit)
+                while(activeNodes[level.top - 1] == 0) {
+                    --level.top;
+                }
+                i = ((level.top - 1) * 64) + 64 - std::countl_zero(activeNodes[level.top - 1]);
+
+                if(size + c[i] <= maxCliqueSize) {
+                    stats.prune(Bound::RussianDoll);
+                    done = true;
+                } else if(size + level.colors <= maxCliqueSize) {
+                    stats.prune(Bound::Coloring);
+                    done = true;
+                }
+            }
+
+            if(done) {
+                if(depth == 0) {
+                    return;
+                }
+                --depth;
+                continue;
+            }
 
-        tempClique.erase(i);
+            // Remove node
+            activeNodes[(i - 1) / 64] &= ~(1UL << ((i - 1) & 63UL));
+            --level.graphSize;
 
-        graphSize--;
+            clique.resize(size + 1);
+            clique[size] = i;
+            stats.node(size + 1);
+
+            uint64_t* nextActiveNodes = activeNodes + words;
+            // Vertices above the highest active one can't be in the next depth either.
+            uint32_t graphSize = bitset_kernels::andIntoCount(nextActiveNodes, activeNodes, graph.neighbours(i), level.top);
+
+            if(graphSize == 0) {
+                offer(size + 1);
+                if(size + 1 > c[root - 1]) {
+                    // No clique with root as largest vertex can be larger than this one.
+                    return;
+                }
+                continue;
+            }
+
+            levels[depth + 1] = { graphSize, level.top, noColorBound };
+            if(depth + 1 < colorDepth) {
+                levels[depth + 1].colors = countColors(nextActiveNodes, level.top, size + 1);
+            }
+            ++depth;
+        }
     }
-}
 
-int main(int argc, char* argv[]) {
-    if(argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " [filename]" << std::endl;
-        return 1;
+private:
+    struct Level {
+        // Number of active nodes
+        uint32_t graphSize;
+        // Number of words up to the highest non-zero one
+        uint32_t top;
+        // Number of colors in a greedy coloring of the active nodes, noColorBound if they weren't colored
+        uint32_t colors;
+    };
+
+    static constexpr uint32_t noColorBound = UINT32_MAX / 2;
+
+    /**
+     * @brief   Greedy sequential coloring of a set of active nodes, one color class at a time: a class takes the first
+     *          uncolored vertex and drops its neighbours, until no vertex is left.
+     * @param activeNodes   The set
+     * @param top           Number of words up to the highest non-zero one
+     * @param size          Size of the clique the set extends
+     * @retval  The number of colors, or noColorBound once it is clear the coloring won't prune: a coloring that is
+     *          cut short is no bound at all.
+     */
+    uint32_t countColors(const uint64_t* activeNodes, uint32_t top, uint32_t size) {
+        // Once the colors reach what the clique still needs to beat the incumbent the branch can't be pruned any
+        // more, so counting further is wasted work.
+        const uint32_t useful = incumbent.size() > size ? incumbent.size() - size : 0;
+
+        std::copy(activeNodes, activeNodes + top, uncolored.begin());
+        uint32_t colors = 0;
+        for(uint32_t first = 0; first < top; ) {
+            if(uncolored[first] == 0) {
+                ++first;
+                continue;
+            }
+            if(++colors > useful) {
+                return noColorBound;
+            }
+
+            std::copy(uncolored.begin() + first, uncolored.begin() + top, colorClass.begin() + first);
+            for(uint32_t word = first; word < top; ++word) {
+                while(colorClass[word] != 0) {
+                    uint32_t vertex = (word << 6UL) + std::countr_zero(colorClass[word]);
+                    colorClass[word] &= colorClass[word] - 1;
+                    uncolored[word] &= ~(1UL << (vertex & 63UL));
+
+                    // Neighbours of this vertex can't share its color.
+                    const uint64_t* neighbours = graph.neighbours(vertex + 1);
+                    for(uint32_t other = word; other < top; ++other) {
+                        colorClass[other] &= ~neighbours[other];
+                    }
+                }
+            }
+        }
+        return colors;
     }
 
-    Graph2D graph;
-    try {
-        ClqParser parser;
-        parser.parse(*argv[1], graph);
-    } catch(std::exception& e) {
-        std::cerr << "Parsing failure: " << e.what() << std::endl;
-        return 2;
+    /**
+     * @brief   Makes sure the stack has room for the given depth. Only grows, so a thread allocates at most once per depth.
+     */
+    void reserve(uint32_t depth) {
+        if(levels.size() <= depth) {
+            levels.resize(depth + 1);
+            sets.resize((size_t) (depth + 1) * words);
+        }
     }
 
-    std::cout << "Graph of " << graph.numberOfVertices << " vertices, " << graph.numberOfEdges << " edges, density " << graph.density() << std::endl;
+    void offer(uint32_t size) {
+        // Recorded under the lock of the incumbent, so the improvements of the workers stay in order.
+        incumbent.offer(size, [&](DynamicBitSet& maxClique) {
+            maxClique = DynamicBitSet { graph.numberOfVertices + 1 };
+            for(uint32_t j = 0; j < size; ++j) {
+                maxClique.insert(clique[j]);
+            }
+            stats.incumbent(size);
+        });
+    }
 
+    const Graph2D& graph;
+    const CliqueBounds& c;
+    CliqueIncumbent& incumbent;
+    SearchStats& stats;
+    const uint32_t colorDepth;
+    const uint32_t words;
+    // Scratch sets of the coloring
+    std::vector<uint64_t> uncolored;
+    std::vector<uint64_t> colorClass;
+    // Active nodes of every depth, one after the other
+    std::vector<uint64_t> sets;
+    std::vector<Level> levels;
+    // The vertex picked at every depth
+    std::vector<uint32_t> clique;
+};
+
+/**
+ * @brief   Search for the maximum clique with Ostergard's algorithm
+ * @param graph The graph, gets reordered and peeled
+ * @param stats Statistics of the search tree, only collected when built with SEARCH_STATS
+ * @param threads   Number of threads, every thread takes the next subproblem when it is done with one
+ * @param colorDepth    Depths below this one also bound with a coloring, 0 turns the coloring off
+ * @retval  A result structure containing the best clique, its size, and the mapping from sorted -> original vertices.
+ */
+Result search(Graph2D& graph, SearchStats& stats, uint32_t threads, uint32_t colorDepth) {
     // Sort the graph
-    OffsetArray<uint32_t, 1> actNode = graph.sortByEdgeDensity(0.40f, std::max_element);
+    OffsetArray<uint32_t, 1> actNode = graph.reorder(VertexOrdering::DegreeDescending, 0.40f);
 
-    uint32_t amountOfBitVectors = (graph.numberOfVertices + 64 - 1) / 64;
-    uint32_t maxCliqueSize = 0;
-    DynamicBitSet maxClique { graph.numberOfVertices + 1 };
-    bool found = false;
-    OffsetArray<uint32_t, 1> c { graph.numberOfVertices };
-    for(uint32_t i = 1; i <= graph.numberOfVertices; ++i)
-        c[i] = graph.numberOfVertices;
+    // A max clique is at least as large as a greedy one, so it lies in the truss and the core of that size. The
+    // edges and vertices outside of them are dropped, the sorted order of the vertices left is kept. The truss goes
+    // first, the vertices that lose their edges drop out of the core as well.
+    const uint32_t lowerBound = greedyCliqueSize(graph);
+    if(peelTruss(graph, lowerBound) > 0) {
+        std::cout << "Edges left in the " << lowerBound << "-truss: " << graph.numberOfEdges << std::endl;
+    }
+    CoreReduction reduction(graph.numberOfVertices);
+    if(reduction.update(graph, lowerBound)) {
+        OffsetArray<uint32_t, 1> kept { graph.numberOfVertices };
+        for(uint32_t i = 1; i <= graph.numberOfVertices; ++i) {
+            kept[i] = actNode[reduction.original(i)];
+        }
+        actNode = std::move(kept);
+        std::cout << "Vertices left in the " << lowerBound - 1 << "-core: " << graph.numberOfVertices << std::endl;
+    }
 
-    // A bitvector of used vertices in an iteration
-    OffsetArray<uint64_t, 1> activeNodes { amountOfBitVectors };
+    const uint32_t N = graph.numberOfVertices;
+    CliqueIncumbent incumbent;
+    CliqueBounds c(N);
+    // Subproblems are handed out in order, so the bounds they need are mostly final.
+    std::atomic<uint32_t> nextSubproblem = 1;
 
-    for(uint32_t i = 1; i <= graph.numberOfVertices; ++i) {
-        found = false;
+    auto work = [&](SearchStats& stats) {
+        SubproblemSearch subproblem(graph, c, incumbent, stats, colorDepth);
+        for(uint32_t i = nextSubproblem++; i <= N; i = nextSubproblem++) {
+            subproblem.search(i);
+            c.finish(i, incumbent.size());
+        }
+    };
 
-        // Array to keep track of nodes along the way
-        DynamicBitSet tempClique { graph.numberOfVertices + 1 };
-        tempClique.insert(i);
+    if(threads > 1) {
+        std::vector<SearchStats> threadStats;
+        for(uint32_t thread = 0; thread < threads; ++thread) {
+            threadStats.push_back(stats.fork());
+        }
+        std::vector<std::thread> workers;
+        for(uint32_t thread = 1; thread < threads; ++thread) {
+            workers.emplace_back(work, std::ref(threadStats[thread]));
+        }
+        work(threadStats[0]);
+        for(std::thread& worker : workers) {
+            worker.join();
+        }
+        for(const SearchStats& other : threadStats) {
+            stats.merge(other);
+        }
+    } else {
+        work(stats);
+    }
+    stats.proof();
 
-        auto neighbours = graph.neighbours(i);
+    return {
+        .maxClique = std::move(incumbent.get()),
+        .actNode = std::move(actNode),
+        .maxCliqueSize = incumbent.size(),
+    };
+}
 
-        // Initialize active nodes array
-        for(uint32_t j = 1; j <= amountOfBitVectors; ++j) {
-            // All nodes in a vector are smaller than i
-            if(i > j * 64) {
-                activeNodes[j] = UINT64_MAX;
-            }
+#ifdef DO_BENCHMARK
 
-            // i is somewhere in this vector
-            else if((j - 1) * 64 < i && i <= j * 64) {
-                activeNodes[j] = UINT64_MAX >> (i & 63UL);
-            }
+int main(int argc, char* argv[]) {
+    return benchmark_suite::run(argc, argv, { "../../project_2/TestData" }, [] {
+        // Without a given corpus the hard instances (keller5, DSJC1000_5, C250.9, ...) are left out, they take far
+        // longer than a benchmark run.
+        benchmark_suite::registerSolver<Graph2D, ClqParser>("Ostergard", [](unsigned) {}, [](Graph2D& graph) {
+            SearchStats stats("Ostergard", { "candidateCount", "russianDoll", "coloring" });
+            benchmark::DoNotOptimize(search(graph, stats, 1, defaultColorDepth));
+        }, { .weighted = false, .maxVertices = 500, .maxDensity = 0.75 });
+    });
+}
 
-            // All zeroes, we already handled i
-            else {
-                activeNodes[j] = 0UL;
+#else
+
+int main(int argc, char* argv[]) {
+    const char* fileName = nullptr;
+    std::string statsFileName;
+    uint32_t threads = 1;
+    uint32_t colorDepth = defaultColorDepth;
+    try {
+        for(int i = 1; i < argc; ++i) {
+            if(parseStatsFlag(argv[i], statsFileName) || parseThreadsFlag(argv[i], threads) || parseNumberFlag(argv[i], "--color-depth=", colorDepth)) {
+                continue;
             }
+            if(fileName != nullptr) {
+                throw std::invalid_argument("Too many arguments");
+            }
+            fileName = argv[i];
         }
+    } catch(std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        fileName = nullptr;
+    }
+    if(fileName == nullptr) {
+        std::cerr << "Usage: " << argv[0] << " [--stats=<json file>] [--threads=<n>] [--color-depth=<n>] [filename]" << std::endl;
+        return 1;
+    }
 
-        clique(graph, activeNodes, neighbours, 1, maxClique, tempClique, maxCliqueSize, found, c);
-        c[i] = maxCliqueSize;
+    Graph2D graph;
+    try {
+        GraphCache<ClqParser> cache;
+        cache.load(*fileName, graph);
+    } catch(std::exception& e) {
+        std::cerr << "Parsing failure: " << e.what() << std::endl;
+        return 2;
     }
 
-    std::cout << "Max clique has size " << maxCliqueSize << std::endl;
+    std::cout << "Graph of " << graph.numberOfVertices << " vertices, " << graph.numberOfEdges << " edges, density " << graph.density() << std::endl;
+
+    SearchStats stats("Ostergard", { "candidateCount", "russianDoll", "coloring" });
+    auto result = search(graph, stats, threads, colorDepth);
+
+    std::cout << "Max clique has size " << result.maxCliqueSize << std::endl;
     std::cout << "Max clique: { ";
-    for(uint32_t i : maxClique) {
-        std::cout << actNode[i] << " ";
+    for(uint32_t i : result.maxClique) {
+        std::cout << result.actNode[i] << " ";
     }
     std::cout << "}" << std::endl;
 
+    if(!statsFileName.empty()) {
+        try {
+            stats.writeJson(statsFileName);
+        } catch(std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 3;
+        }
+    }
+
     return 0;
-}
\ No newline at end of file
+}
+
+#endif
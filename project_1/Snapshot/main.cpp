@@ -0,0 +1,63 @@
+#include <iostream>
+#include <cstring>
+
+#include <graph.hpp>
+#include <clq_parser.hpp>
+#include <graph_snapshot.hpp>
+
+/**
+ * @brief   Parses the source file into a graph of type G and writes its snapshot next to it.
+ * @retval  Whether the snapshot was written.
+ */
+template<typename G>
+bool convert(const char* fileName) {
+    G graph;
+    ClqParser parser;
+    parser.parse(*fileName, graph);
+
+    std::string snapshotPath = GraphSnapshot::pathFor<G>(fileName);
+    if(!GraphSnapshot::save(snapshotPath.c_str(), graph, GraphSnapshot::sourceInfo(fileName))) {
+        std::cerr << "Could not write " << snapshotPath << std::endl;
+        return false;
+    }
+
+    std::cout << snapshotPath << ": " << graph.numberOfVertices << " vertices, " << graph.numberOfEdges << " edges" << std::endl;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if(argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " [filename] [2d|lower|list]..." << std::endl;
+        return 1;
+    }
+
+    // Without explicit layouts, write one for every storage backend.
+    const char* allLayouts[] = { Graph2D::snapshotName, LowerTriangularGraph::snapshotName, ListGraph::snapshotName };
+    const char* const* layouts = argc > 2 ? argv + 2 : allLayouts;
+    int amountOfLayouts = argc > 2 ? argc - 2 : 3;
+
+    try {
+        for(int i = 0; i < amountOfLayouts; ++i) {
+            bool ok;
+            if(strcmp(layouts[i], Graph2D::snapshotName) == 0) {
+                ok = convert<Graph2D>(argv[1]);
+            } else if(strcmp(layouts[i], LowerTriangularGraph::snapshotName) == 0) {
+                ok = convert<LowerTriangularGraph>(argv[1]);
+            } else if(strcmp(layouts[i], ListGraph::snapshotName) == 0) {
+                ok = convert<ListGraph>(argv[1]);
+            } else {
+                std::cerr << "Unknown layout " << layouts[i] << std::endl;
+                return 1;
+            }
+
+            if(!ok) {
+                return 3;
+            }
+        }
+    } catch(std::exception& e) {
+        std::cerr << "Parsing failure: " << e.what() << std::endl;
+        return 2;
+    }
+
+    return 0;
+}
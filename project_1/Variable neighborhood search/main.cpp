@@ -7,218 +7,137 @@
 #include <matrix.hpp>
 #include <graph.hpp>
 #include <clq_parser.hpp>
+#include <graph_snapshot.hpp>
+#include <graph_dispatch.hpp>
+#include <flags.hpp>
+#include <anytime.hpp>
+#include <variable_neighborhood_search.hpp>
+#include <work_stealing.hpp>
+#include <bitset.hpp>
+#include <bitset_kernels.hpp>
 #include <math.h>
-#include <set>
+#include <vector>
+#include <bit>
 #include <random>
-#include <map>
+#include <thread>
 
+// Defined by "make bench".
+#ifdef DO_BENCHMARK
+#include <benchmark_suite.hpp>
+#endif
 
-typedef uint32_t Vertex;
-typedef std::set<Vertex> Clique;
 
-Clique biggestClique;
-Clique currBiggestClique;
-int* resultClique;
+// Storage for dense graphs when no --graph flag is given, sparse inputs are stored as a CsrGraph instead.
+static constexpr GraphLayout defaultLayout = GraphLayout::List;
 
-const int KMax = 15;
+// Command line options of the search
+struct VnsOptions {
+    // Number of chains, each on its own thread
+    uint32_t threads = 1;
+    // Seed every chain derives its random numbers from
+    uint64_t seed = 0;
+    // Stop all chains once a clique of this size is found, 0 runs until the chains give up
+    uint32_t target = 0;
+};
 
-std::map<Clique, std::set<Clique>> neighborhoods;
-size_t iterationsSinceImprovement = 0;
-std::set<Vertex> possibleNodes;
-
-// Get degree of the vertex in the graph
-int getDegree(ListGraph* graph, Vertex v) {
-    int result = 0;
-    for(uint32_t i=0; i<graph->numberOfVertices; i++){
-        if(i != v) {
-            if (graph->hasEdge(i+1, v+1)) result++;
-        }
-    }
-    return result;
-}
-
-// gives all nodes from the graph that can be added to the clique
-Clique getPossibleAdds(ListGraph* graph, Clique clique) {
-    // make possible nodes empty
-    possibleNodes.clear();
-    // Add all nodes to possible nodes
-    for (uint32_t i=0; i<graph->numberOfVertices; i++) {
-        possibleNodes.insert(i);
-    }
-    Clique result;
-    // check for all nodes if they are adjacent to all nodes from the clique, if this is the case add them to result
-    for (Vertex v1 : possibleNodes) {
-        // if vertex in clique continue
-        if(clique.find(v1) != clique.end()) continue;
-        bool canAdd = true;
-        // check if v is adjacent to all Vertices of clique
-        for (Vertex v2 : clique) {
-            // if a vertex is not adjacent with v1 break
-            if (!graph->hasEdge(v1+1, v2+1)){
-                canAdd = false;
-                break;
-            }
-        }
-        // if all Vertices of the clique were adjacent with v1 add it to result
-        if (canAdd) result.insert(v1);
+// Perform variable neighborhood search on the graph to get the biggest clique, with one chain per thread
+// stops early when the budget of anytime is used up, with the biggest clique found until then
+// return the size of the biggest clique
+template<typename G>
+int vns(G* graph, const VnsOptions& options, Anytime& anytime) {
+    const VnsGraph vnsGraph(*graph);
+    SharedClique shared;
+
+    auto work = [&](uint32_t chain) {
+        VnsRun(vnsGraph, shared, anytime, options.seed, chain).run(options.target);
+    };
+    std::vector<std::thread> workers;
+    for (uint32_t chain = 1; chain < options.threads; chain++) {
+        workers.emplace_back(work, chain);
     }
-    return result;
-}
-
-// Do local search to get maximum clique that can be made from clique
-// we do this by adding the best vertices one by one
-Clique vnd(ListGraph* graph, Clique clique) {
-    Clique currBest = clique;
-    // get all vertices that can be added to the clique
-    Clique poss = getPossibleAdds(graph, clique);
-    // while we find nodes we can add to the clique, find the best one and add it to the clique
-    while (poss.size() > 0) {
-        int bestDegree = -1;
-        Vertex bestVertex;
-        // 80% Chance that we take the highest degree as best vertex 20% chance we take the lowest degree
-        bool isBest = (rand() % 100) > 20;
-        // get The degree from all poss and pick the highest/lowest as best vertex based ion isBest
-        for(Vertex v : poss) {
-            int currDegree = getDegree(graph, v);
-            if (bestDegree == -1 || (isBest && currDegree >= bestDegree) || (!isBest && currDegree <= bestDegree)) {
-                bestDegree = currDegree;
-                bestVertex = v;
-            }
-        }
-        // add the best vertex to the clique
-        clique.insert(bestVertex);
-        // find vertices we can add to the new clique
-        poss = getPossibleAdds(graph, clique);
+    work(0);
+    for (std::thread& worker : workers) {
+        worker.join();
     }
-    
-    return clique;
-}
 
-// get the direct neighborhood of clique (all cliques on distance 1)
-std::set<Clique> getNeighborhood(ListGraph* graph, Clique clique) {
-    Clique cliqueCopy = clique;
-    // get all vertices we can add to clique that will stay a clique
-    Clique adds = getPossibleAdds(graph, clique);
-    std::set<Clique> result;
-    // add all possible neighbors by adding a vertex
-    for(Vertex v: adds) {
-        cliqueCopy.insert(v);
-        result.insert(cliqueCopy);
-        cliqueCopy.erase(v);
+    const Clique& biggestClique = shared.get();
+    // print the biggest clique for debugging purposses only
+    std::cout << "biggest clique: ";
+    for (Vertex v : biggestClique) {
+        std::cout << v << ", ";
     }
-    // add all possible neighbors by removing a vertex
-    for (Vertex v : clique) {
-        // if clique size is one we can not remove a vertex
-        if (clique.size() == 1) break;
-        cliqueCopy.erase(v);
-        result.insert(cliqueCopy);
-        cliqueCopy.insert(v);
+    std::cout << std::endl;
+    if (anytime.expired()) {
+        std::cout << "Budget used up" << std::endl;
     }
-    return result;
+    std::cout << "Found after: " << anytime.timeToBest() << " s" << std::endl;
+    return biggestClique.size();
 }
 
-// get clique n from s 
-Clique getCliqueN(std::set<Clique> s, int n) {
-  std::set<Clique>::iterator it = s.begin();
-  // 'advance' the iterator n times
-  std::advance(it,n);
-  return *it;
-}
+// One instantiation per storage backend, withGraph picks one of them at startup.
+template int vns(Graph2D*, const VnsOptions&, Anytime&);
+template int vns(LowerTriangularGraph*, const VnsOptions&, Anytime&);
+template int vns(ListGraph*, const VnsOptions&, Anytime&);
+template int vns(CsrGraph*, const VnsOptions&, Anytime&);
 
-// get a random clique from neighborhood k
-Clique shake(int k, ListGraph* graph, Clique clique) {
-    // Get the neighborhood 1 of the current clique and choose one randomly from that neighborhood
-    // Do this k times so we will have a clique on distance k from the original clique 
-    for (int i=0; i<k; i++){
-        // if the neighborhood of the clique was not yet calculated before
-        if(neighborhoods.find(clique) == neighborhoods.end()) {
-            // calculate the neighborhood of the current clique
-            neighborhoods[clique] = getNeighborhood(graph, clique);
-        }
-        std::set<Clique> currNeighborhood = neighborhoods[clique];
-        // get a random index of currNeighborhood
-        int randIndex = (rand() % static_cast<int>(currNeighborhood.size()));
-        // get a random clique from currNeighborhood
-        clique = getCliqueN(currNeighborhood, randIndex);
-    }
-    return clique;
-}
+#ifdef DO_BENCHMARK
 
-void vnsStep(ListGraph* graph) {
-    int k = 0;
-    // Try to search new optimum in neighborhood k
-    // neighborhood k has all cliques with distance k of currBiggestClique 
-    // (e.g. for k=2: 2 additions, or 2 deletions or 1 addition and 1 deltion)
-    while (k < KMax) {
-        // choose random clique from neighborhood k
-        Clique nClique = shake(k, graph, currBiggestClique);
-        // perform local search on nClique here with variable neighbourhood decent
-        Clique localBest = vnd(graph, nClique);
-        // check if localBest is bigger than currBiggestClique
-        if (localBest.size() > currBiggestClique.size()) {
-            currBiggestClique = localBest;
-            // start searching again from neighborhood 0 with new localBest
-            k = 0;
-        } else {
-            k++;
-        }
-    }
-    return;
+int main(int argc, char* argv[]) {
+    static VnsOptions options;
+    return benchmark_suite::run(argc, argv, { "../../project_2/TestData" }, [] {
+        benchmark_suite::registerSolver<ListGraph, ClqParser>("VariableNeighborhoodSearch", [](unsigned seed) { options.seed = seed; }, [](ListGraph& graph) {
+            Anytime anytime(0);
+            benchmark::DoNotOptimize(vns(&graph, options, anytime));
+        }, { .weighted = false });
+    });
 }
 
-// Perform variable neighborhood search on the graph to get the biggest clique
-// return the size of the biggest clique
-int vns(ListGraph* graph) {
+#else
+
+int main(int argc, char* argv[]) {
+    GraphLayout layout = GraphLayout::Auto;
+    uint64_t budgetMs = 0;
+    VnsOptions options;
     // get random seed for randomness
-    srand((unsigned) time(0));
-    // max iterations of vns we will do before we stop
-    size_t maxItNoImprov = 50;
-
-    //set initial solution
-    uint32_t randomStart = (rand() % static_cast<int>(graph->numberOfVertices));
-    biggestClique = {randomStart};
-    currBiggestClique = {randomStart};
-
-    // while we have not had maxItNoImprov iterations without improvements do a vns step
-    while (iterationsSinceImprovement < maxItNoImprov) {
-        vnsStep(graph);
-        // If the biggestClique found is the biggest yet we store it in biggestClique
-        if (currBiggestClique.size() > biggestClique.size()) {
-            iterationsSinceImprovement = 0;
-            biggestClique = currBiggestClique;
+    options.seed = std::random_device{}();
+    const char* fileName = nullptr;
+    try {
+        for(int i = 1; i < argc; ++i) {
+            if(parseGraphLayout(argv[i], layout) || parseNumberFlag(argv[i], "--budget-ms=", budgetMs)
+               || parseThreadsFlag(argv[i], options.threads) || parseNumberFlag(argv[i], "--seed=", options.seed) || parseNumberFlag(argv[i], "--target=", options.target)) {
+                continue;
+            }
+            if(fileName != nullptr) {
+                throw std::invalid_argument("Too many arguments");
+            }
+            fileName = argv[i];
         }
-        iterationsSinceImprovement++;
-        std::cout << "it no improv: " << iterationsSinceImprovement << " biggest clique:" << biggestClique.size() << std::endl;
-    }
-    // print the biggest clique for debugging purposses only
-    std::cout << "biggest clique: ";
-    for (Vertex v : biggestClique) {
-        std::cout << v << ", ";
+    } catch(std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        fileName = nullptr;
     }
-    std::cout << std::endl;
-    return biggestClique.size();
-}
-
-int main(int argc, char* argv[]) {
-    if(argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " [filename]" << std::endl;
+    if(fileName == nullptr) {
+        std::cerr << "Usage: " << argv[0] << " [--graph=auto|2d|lower|list|csr] [--budget-ms=<n>] [--threads=<n>] [--seed=<n>] [--target=<size>] [filename]" << std::endl;
         return 1;
     }
 
-    ListGraph graph;
     try {
-        ClqParser parser;
-        parser.parse(*argv[1], graph);
+        // The budget includes reading the graph.
+        Anytime anytime(budgetMs);
+        return withGraph<ClqParser>(layout, defaultLayout, *fileName, [&](auto& graph) {
+            const uint32_t N = graph.numberOfVertices;
+
+            std::cout << "Grah of " << N << " vertices, " << graph.numberOfEdges << " edges, density " << graph.density() << std::endl;
+            std::cout << "Seed: " << options.seed << std::endl;
+            int cliqueSize = vns(&graph, options, anytime);
+            std::cout << "Size of max clique: " << cliqueSize << std::endl;
+
+            return 0;
+        });
     } catch(std::exception& e) {
         std::cerr << "Parsing failure: " << e.what() << std::endl;
         return 2;
     }
-
-    const uint32_t N = graph.numberOfVertices;
-
-    std::cout << "Grah of " << N << " vertices, " << graph.numberOfEdges << " edges, density " << graph.density() << std::endl;
-    int cliqueSize = vns(&graph);
-    std::cout << "Size of max clique: " << cliqueSize << std::endl;
-
-    return 0;
 }
+
+#endif
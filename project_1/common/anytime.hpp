@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <iostream>
+
+/**
+ * Wall-clock budget of a heuristic that can stop at any time, and the report of its best solution so far.
+ *
+ * The heuristics check expired() between small units of work (a start, an iteration), so they stop shortly after the
+ * budget is used up and return the best solution they have at that point. Every improvement is written to stdout
+ * with the time since the start, a caller that has to kill the process still has the last one.
+ */
+class Anytime final {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @param budgetMs  Budget in milliseconds from now on, 0 for no budget
+     */
+    explicit Anytime(uint64_t budgetMs)
+        : start(Clock::now()), deadline(budgetMs == 0 ? Clock::time_point::max() : start + std::chrono::milliseconds(budgetMs)) {}
+
+    Anytime(const Anytime&) = delete;
+
+    /**
+     * @brief   Whether the budget is used up or the run was stopped, without a budget only the latter.
+     */
+    inline bool expired() const {
+        return stopped.load(std::memory_order_relaxed) || (deadline != Clock::time_point::max() && Clock::now() >= deadline);
+    }
+
+    /**
+     * @brief   Ends the run before its budget, expired() is true from now on. For the solver that is waiting on it.
+     */
+    void stop() {
+        stopped.store(true, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief   Seconds since the start.
+     */
+    inline double elapsed() const {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    /**
+     * @brief   Reports a solution if it is better than the best so far, can be called by several threads.
+     * @param value Size of the solution
+     */
+    void improve(uint64_t value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(value <= best) {
+            return;
+        }
+        best = value;
+        bestSeconds = elapsed();
+        std::cout << "Best so far: " << best << " after " << bestSeconds << " s" << std::endl;
+    }
+
+    /**
+     * @brief   Seconds from the start until the best solution was first reported.
+     */
+    double timeToBest() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return bestSeconds;
+    }
+
+private:
+    Clock::time_point start;
+    Clock::time_point deadline;
+    std::atomic<bool> stopped = false;
+    std::mutex mutex;
+    uint64_t best = 0;
+    double bestSeconds = 0.0;
+};
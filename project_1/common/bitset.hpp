@@ -5,6 +5,10 @@
 #include <cassert>
 #include <utility>
 #include <cstring>
+#include <algorithm>
+
+#include <bitset_kernels.hpp>
+#include <bitset_arena.hpp>
 
 class DynamicBitSet;
 
@@ -40,7 +44,20 @@ public:
         storage = new uint64_t[arrayLength]();
     }
 
-    DynamicBitSet(DynamicBitSet&& other) : storage(std::exchange(other.storage, nullptr)), arrayLength(other.arrayLength) {}
+    // Empty set with its words taken from the arena. The set must not outlive the arena scope it was made in.
+    DynamicBitSet(size_t amountOfBits, BitSetArena& arena) : owned(false) {
+        arrayLength = (amountOfBits + 64 - 1) / 64;
+        storage = arena.allocate(arrayLength);
+        clear();
+    }
+
+    // Copy into arena storage.
+    DynamicBitSet(const DynamicBitSet& other, BitSetArena& arena) : arrayLength(other.arrayLength), owned(false) {
+        storage = arena.allocate(arrayLength);
+        memcpy(storage, other.storage, sizeof(uint64_t) * arrayLength);
+    }
+
+    DynamicBitSet(DynamicBitSet&& other) : storage(std::exchange(other.storage, nullptr)), arrayLength(other.arrayLength), owned(other.owned) {}
 
     DynamicBitSet(const DynamicBitSet& other) : arrayLength(other.arrayLength) {
         storage = new uint64_t[arrayLength];
@@ -48,15 +65,23 @@ public:
     }
 
     DynamicBitSet& operator=(const DynamicBitSet& other) {
-        delete[] storage;
-        arrayLength = other.arrayLength;
-        storage = new uint64_t[arrayLength];
+        // Sets of the same size (the usual case) are copied in place, which also keeps arena storage in the arena.
+        if(arrayLength != other.arrayLength || storage == nullptr) {
+            if(owned) {
+                delete[] storage;
+            }
+            arrayLength = other.arrayLength;
+            storage = new uint64_t[arrayLength];
+            owned = true;
+        }
         memcpy(storage, other.storage, sizeof(uint64_t) * arrayLength);
         return *this;
     }
 
     ~DynamicBitSet() {
-        delete[] storage;
+        if(owned) {
+            delete[] storage;
+        }
     }
 
     void clear() {
@@ -64,10 +89,7 @@ public:
     }
 
     bool empty() const {
-        for(size_t i = 0; i < arrayLength; ++i) {
-            if(storage[i] != 0) return false;
-        }
-        return true;
+        return !bitset_kernels::andAny(storage, storage, arrayLength);
     }
 
     void fill() {
@@ -77,11 +99,7 @@ public:
     }
 
     size_t size() const {
-        size_t sum = 0;
-        for(size_t i = 0; i < arrayLength; ++i) {
-            sum += std::popcount(storage[i]);
-        }
-        return sum;
+        return bitset_kernels::count(storage, arrayLength);
     }
 
     DynamicBitSet intersectionWith(const DynamicBitSet& other) const {
@@ -90,9 +108,19 @@ public:
         DynamicBitSet ret {};
         ret.arrayLength = arrayLength;
         ret.storage = new uint64_t[arrayLength];
-        for(size_t i = 0; i < arrayLength; ++i) {
-            ret.storage[i] = storage[i] & other.storage[i];
-        }
+        bitset_kernels::andIntoCount(ret.storage, storage, other.storage, arrayLength);
+
+        return ret;
+    }
+
+    DynamicBitSet intersectionWith(const DynamicBitSet& other, BitSetArena& arena) const {
+        assert(other.arrayLength == arrayLength);
+
+        DynamicBitSet ret {};
+        ret.arrayLength = arrayLength;
+        ret.storage = arena.allocate(arrayLength);
+        ret.owned = false;
+        bitset_kernels::andIntoCount(ret.storage, storage, other.storage, arrayLength);
 
         return ret;
     }
@@ -119,10 +147,18 @@ public:
         storage[bit >> 6UL] |= 1UL << (bit & 63UL);
     }
 
+    void insertAll(const DynamicBitSet& other) {
+        bitset_kernels::orInto(storage, storage, other.storage, std::min(arrayLength, other.arrayLength));
+    }
+
     void erase(uint32_t bit) {
         storage[bit >> 6UL] &= ~(1UL << (bit & 63UL));
     }
 
+    void eraseAll(const DynamicBitSet& other) {
+        bitset_kernels::andNotInto(storage, storage, other.storage, std::min(arrayLength, other.arrayLength));
+    }
+
     bool contains(uint32_t bit) const {
         return !!(storage[bit >> 6UL] & (1UL << (bit & 63UL)));
     }
@@ -135,13 +171,56 @@ public:
         return { *this, arrayLength - 1 };
     }
 
+    uint64_t* data() {
+        return storage;
+    }
+
+    const uint64_t* data() const {
+        return storage;
+    }
+
+    size_t wordCount() const {
+        return arrayLength;
+    }
+
     friend class DynamicBitSetIterator;
 
+    // Fused operations, these never build a temporary set.
+    friend size_t intersectCount(const DynamicBitSet& a, const DynamicBitSet& b);
+    friend bool intersectsAny(const DynamicBitSet& a, const DynamicBitSet& b);
+    friend void andNotInto(DynamicBitSet& dst, const DynamicBitSet& a, const DynamicBitSet& b);
+
 private:
     uint64_t* storage;
     size_t arrayLength;
+    // Whether storage was allocated with new[], arena storage is never freed by the set.
+    bool owned { true };
 };
 
+/**
+ * @brief   Amount of elements in the intersection of a and b.
+ */
+inline size_t intersectCount(const DynamicBitSet& a, const DynamicBitSet& b) {
+    assert(a.arrayLength == b.arrayLength);
+    return bitset_kernels::andCount(a.storage, b.storage, a.arrayLength);
+}
+
+/**
+ * @brief   Whether a and b have at least one element in common.
+ */
+inline bool intersectsAny(const DynamicBitSet& a, const DynamicBitSet& b) {
+    assert(a.arrayLength == b.arrayLength);
+    return bitset_kernels::andAny(a.storage, b.storage, a.arrayLength);
+}
+
+/**
+ * @brief   dst = a \ b, dst may be the same set as a or b.
+ */
+inline void andNotInto(DynamicBitSet& dst, const DynamicBitSet& a, const DynamicBitSet& b) {
+    assert(a.arrayLength == b.arrayLength && dst.arrayLength == a.arrayLength);
+    bitset_kernels::andNotInto(dst.storage, a.storage, b.storage, a.arrayLength);
+}
+
 bool operator!=(const DynamicBitSetIterator& x, const DynamicBitSetIterator& y) {
     return !(x == y);
 }
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+/**
+ * Stack allocator for bitset words.
+ *
+ * A search takes the scratch sets of a depth with allocate() and gives all of them back at once on backtrack by
+ * releasing to the mark it took before, so the search itself never calls new or delete. Memory comes in blocks
+ * that stay around for reuse, words that were handed out never move.
+ */
+class BitSetArena final {
+public:
+    struct Mark {
+        size_t block;
+        size_t used;
+    };
+
+    /**
+     * Releases everything allocated during its lifetime when it goes out of scope.
+     */
+    class Scope final {
+    public:
+        Scope(BitSetArena& arena) : arena(arena), mark(arena.mark()) {}
+        Scope(const Scope&) = delete;
+        ~Scope() {
+            arena.release(mark);
+        }
+
+    private:
+        BitSetArena& arena;
+        Mark mark;
+    };
+
+    // Every allocation is rounded up to a cache line.
+    static constexpr size_t lineWords = 64 / sizeof(uint64_t);
+
+    BitSetArena(size_t blockWords = 1 << 16) : blockWords(roundUp(blockWords)) {}
+    BitSetArena(const BitSetArena&) = delete;
+    ~BitSetArena() {}
+
+    /**
+     * @brief   Takes words from the top of the stack.
+     * @note    The words are not zeroed.
+     */
+    uint64_t* allocate(size_t words) {
+        words = roundUp(std::max<size_t>(words, 1));
+
+        // Blocks further up the stack that are too small are skipped, they get used again after a release.
+        while(current < blocks.size() && used + words > blocks[current].size) {
+            ++current;
+            used = 0;
+        }
+        if(current == blocks.size()) {
+            size_t size = std::max(blockWords, words);
+            blocks.push_back({ std::unique_ptr<uint64_t[], Free>(static_cast<uint64_t*>(std::aligned_alloc(64, size * sizeof(uint64_t)))), size });
+            if(blocks.back().words == nullptr) {
+                blocks.pop_back();
+                throw std::bad_alloc();
+            }
+            used = 0;
+        }
+
+        uint64_t* result = blocks[current].words.get() + used;
+        used += words;
+        return result;
+    }
+
+    Mark mark() const {
+        return { current, used };
+    }
+
+    /**
+     * @brief   Gives back everything allocated since the mark was taken, in O(1).
+     */
+    void release(Mark mark) {
+        current = mark.block;
+        used = mark.used;
+    }
+
+private:
+    struct Free {
+        void operator()(uint64_t* words) const {
+            std::free(words);
+        }
+    };
+
+    struct Block {
+        std::unique_ptr<uint64_t[], Free> words;
+        size_t size;
+    };
+
+    static size_t roundUp(size_t words) {
+        return (words + lineWords - 1) / lineWords * lineWords;
+    }
+
+    std::vector<Block> blocks;
+    size_t blockWords;
+    size_t current { 0 };
+    size_t used { 0 };
+};
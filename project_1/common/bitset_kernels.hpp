@@ -0,0 +1,282 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <bit>
+#include <immintrin.h>
+
+/**
+ * Word loops used by the bitsets and the solvers that work on raw adjacency rows.
+ *
+ * Every kernel has a scalar version and an AVX2 and AVX-512 version. The vector versions are compiled
+ * with a target attribute, so the Makefiles don't need extra flags, and the best version for the
+ * current CPU is picked once at runtime. Short rows (most of our graphs have less than 512 vertices)
+ * don't go through the function pointers at all, the scalar loop is faster there.
+ */
+namespace bitset_kernels {
+
+// Rows shorter than this many words are handled inline by the scalar loops.
+constexpr size_t dispatchThreshold = 8;
+
+struct KernelTable {
+    const char* name;
+    // Amount of set bits in a.
+    size_t (*count)(const uint64_t* a, size_t length);
+    // Amount of set bits in a & b.
+    size_t (*andCount)(const uint64_t* a, const uint64_t* b, size_t length);
+    // Whether a & b has at least one bit set.
+    bool (*andAny)(const uint64_t* a, const uint64_t* b, size_t length);
+    // dst = a & b, returns the amount of set bits in dst.
+    size_t (*andIntoCount)(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t length);
+    // dst = a & ~b
+    void (*andNotInto)(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t length);
+    // dst = a | b
+    void (*orInto)(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t length);
+};
+
+namespace scalar {
+
+inline size_t count(const uint64_t* a, size_t length) {
+    size_t sum = 0;
+    for(size_t i = 0; i < length; ++i) {
+        sum += std::popcount(a[i]);
+    }
+    return sum;
+}
+
+inline size_t andCount(const uint64_t* a, const uint64_t* b, size_t length) {
+    size_t sum = 0;
+    for(size_t i = 0; i < length; ++i) {
+        sum += std::popcount(a[i] & b[i]);
+    }
+    return sum;
+}
+
+inline bool andAny(const uint64_t* a, const uint64_t* b, size_t length) {
+    for(size_t i = 0; i < length; ++i) {
+        if(a[i] & b[i]) return true;
+    }
+    return false;
+}
+
+inline size_t andIntoCount(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t length) {
+    size_t sum = 0;
+    for(size_t i = 0; i < length; ++i) {
+        dst[i] = a[i] & b[i];
+        sum += std::popcount(dst[i]);
+    }
+    return sum;
+}
+
+inline void andNotInto(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t length) {
+    for(size_t i = 0; i < length; ++i) {
+        dst[i] = a[i] & ~b[i];
+    }
+}
+
+inline void orInto(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t length) {
+    for(size_t i = 0; i < length; ++i) {
+        dst[i] = a[i] | b[i];
+    }
+}
+
+}
+
+namespace avx2 {
+
+// Popcount per 64-bit lane using the nibble lookup table trick (Mula et al.).
+__attribute__((target("avx2"))) inline __m256i popcountLanes(__m256i v) {
+    const __m256i lookup = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+    );
+    const __m256i lowMask = _mm256_set1_epi8(0x0f);
+    __m256i low = _mm256_and_si256(v, lowMask);
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(v, 4), lowMask);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low), _mm256_shuffle_epi8(lookup, high));
+    return _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2"))) inline size_t horizontalSum(__m256i v) {
+    return _mm256_extract_epi64(v, 0) + _mm256_extract_epi64(v, 1) + _mm256_extract_epi64(v, 2) + _mm256_extract_epi64(v, 3);
+}
+
+__attribute__((target("avx2"))) inline size_t count(const uint64_t* a, size_t length) {
+    __m256i sum = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 4 <= length; i += 4) {
+        sum = _mm256_add_epi64(sum, popcountLanes(_mm256_loadu_si256((const __m256i*) (a + i))));
+    }
+    return horizontalSum(sum) + scalar::count(a + i, length - i);
+}
+
+__attribute__((target("avx2"))) inline size_t andCount(const uint64_t* a, const uint64_t* b, size_t length) {
+    __m256i sum = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 4 <= length; i += 4) {
+        __m256i x = _mm256_and_si256(_mm256_loadu_si256((const __m256i*) (a + i)), _mm256_loadu_si256((const __m256i*) (b + i)));
+        sum = _mm256_add_epi64(sum, popcountLanes(x));
+    }
+    return horizontalSum(sum) + scalar::andCount(a + i, b + i, length - i);
+}
+
+__attribute__((target("avx2"))) inline bool andAny(const uint64_t* a, const uint64_t* b, size_t length) {
+    size_t i = 0;
+    for(; i + 4 <= length; i += 4) {
+        // testz returns 1 when a & b is all zeroes.
+        if(!_mm256_testz_si256(_mm256_loadu_si256((const __m256i*) (a + i)), _mm256_loadu_si256((const __m256i*) (b + i)))) {
+            return true;
+        }
+    }
+    return scalar::andAny(a + i, b + i, length - i);
+}
+
+__attribute__((target("avx2"))) inline size_t andIntoCount(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t length) {
+    __m256i sum = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 4 <= length; i += 4) {
+        __m256i x = _mm256_and_si256(_mm256_loadu_si256((const __m256i*) (a + i)), _mm256_loadu_si256((const __m256i*) (b + i)));
+        _mm256_storeu_si256((__m256i*) (dst + i), x);
+        sum = _mm256_add_epi64(sum, popcountLanes(x));
+    }
+    return horizontalSum(sum) + scalar::andIntoCount(dst + i, a + i, b + i, length - i);
+}
+
+__attribute__((target("avx2"))) inline void andNotInto(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t length) {
+    size_t i = 0;
+    for(; i + 4 <= length; i += 4) {
+        // andnot(x, y) computes ~x & y.
+        __m256i x = _mm256_andnot_si256(_mm256_loadu_si256((const __m256i*) (b + i)), _mm256_loadu_si256((const __m256i*) (a + i)));
+        _mm256_storeu_si256((__m256i*) (dst + i), x);
+    }
+    scalar::andNotInto(dst + i, a + i, b + i, length - i);
+}
+
+__attribute__((target("avx2"))) inline void orInto(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t length) {
+    size_t i = 0;
+    for(; i + 4 <= length; i += 4) {
+        __m256i x = _mm256_or_si256(_mm256_loadu_si256((const __m256i*) (a + i)), _mm256_loadu_si256((const __m256i*) (b + i)));
+        _mm256_storeu_si256((__m256i*) (dst + i), x);
+    }
+    scalar::orInto(dst + i, a + i, b + i, length - i);
+}
+
+}
+
+// Only used when the CPU also has VPOPCNTQ, otherwise counting the bits is the bottleneck anyway and AVX2 is just as fast.
+namespace avx512 {
+
+#define AVX512_TARGET __attribute__((target("avx512f,avx512vpopcntdq")))
+
+// By hand instead of _mm512_reduce_add_epi64, whose GCC header reads an uninitialized vector and warns about it.
+AVX512_TARGET inline size_t horizontalSum(__m512i v) {
+    alignas(64) uint64_t lanes[8];
+    _mm512_store_si512(lanes, v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+}
+
+AVX512_TARGET inline size_t count(const uint64_t* a, size_t length) {
+    __m512i sum = _mm512_setzero_si512();
+    size_t i = 0;
+    for(; i + 8 <= length; i += 8) {
+        sum = _mm512_add_epi64(sum, _mm512_popcnt_epi64(_mm512_loadu_si512(a + i)));
+    }
+    return horizontalSum(sum) + scalar::count(a + i, length - i);
+}
+
+AVX512_TARGET inline size_t andCount(const uint64_t* a, const uint64_t* b, size_t length) {
+    __m512i sum = _mm512_setzero_si512();
+    size_t i = 0;
+    for(; i + 8 <= length; i += 8) {
+        __m512i x = _mm512_and_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+        sum = _mm512_add_epi64(sum, _mm512_popcnt_epi64(x));
+    }
+    return horizontalSum(sum) + scalar::andCount(a + i, b + i, length - i);
+}
+
+AVX512_TARGET inline bool andAny(const uint64_t* a, const uint64_t* b, size_t length) {
+    size_t i = 0;
+    for(; i + 8 <= length; i += 8) {
+        if(_mm512_test_epi64_mask(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i))) {
+            return true;
+        }
+    }
+    return scalar::andAny(a + i, b + i, length - i);
+}
+
+AVX512_TARGET inline size_t andIntoCount(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t length) {
+    __m512i sum = _mm512_setzero_si512();
+    size_t i = 0;
+    for(; i + 8 <= length; i += 8) {
+        __m512i x = _mm512_and_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+        _mm512_storeu_si512(dst + i, x);
+        sum = _mm512_add_epi64(sum, _mm512_popcnt_epi64(x));
+    }
+    return horizontalSum(sum) + scalar::andIntoCount(dst + i, a + i, b + i, length - i);
+}
+
+AVX512_TARGET inline void andNotInto(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t length) {
+    size_t i = 0;
+    for(; i + 8 <= length; i += 8) {
+        // a & ~b with an explicit NOT, _mm512_andnot_si512 warns about an uninitialized vector in the GCC header.
+        __m512i notB = _mm512_xor_si512(_mm512_loadu_si512(b + i), _mm512_set1_epi64(-1));
+        _mm512_storeu_si512(dst + i, _mm512_and_si512(_mm512_loadu_si512(a + i), notB));
+    }
+    scalar::andNotInto(dst + i, a + i, b + i, length - i);
+}
+
+AVX512_TARGET inline void orInto(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t length) {
+    size_t i = 0;
+    for(; i + 8 <= length; i += 8) {
+        _mm512_storeu_si512(dst + i, _mm512_or_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i)));
+    }
+    scalar::orInto(dst + i, a + i, b + i, length - i);
+}
+
+#undef AVX512_TARGET
+
+}
+
+inline KernelTable selectKernels() {
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq")) {
+        return { "avx512", avx512::count, avx512::andCount, avx512::andAny, avx512::andIntoCount, avx512::andNotInto, avx512::orInto };
+    }
+    if(__builtin_cpu_supports("avx2")) {
+        return { "avx2", avx2::count, avx2::andCount, avx2::andAny, avx2::andIntoCount, avx2::andNotInto, avx2::orInto };
+    }
+    return { "scalar", scalar::count, scalar::andCount, scalar::andAny, scalar::andIntoCount, scalar::andNotInto, scalar::orInto };
+}
+
+inline const KernelTable& kernels() {
+    static const KernelTable table = selectKernels();
+    return table;
+}
+
+inline size_t count(const uint64_t* a, size_t length) {
+    return length < dispatchThreshold ? scalar::count(a, length) : kernels().count(a, length);
+}
+
+inline size_t andCount(const uint64_t* a, const uint64_t* b, size_t length) {
+    return length < dispatchThreshold ? scalar::andCount(a, b, length) : kernels().andCount(a, b, length);
+}
+
+inline bool andAny(const uint64_t* a, const uint64_t* b, size_t length) {
+    return length < dispatchThreshold ? scalar::andAny(a, b, length) : kernels().andAny(a, b, length);
+}
+
+inline size_t andIntoCount(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t length) {
+    return length < dispatchThreshold ? scalar::andIntoCount(dst, a, b, length) : kernels().andIntoCount(dst, a, b, length);
+}
+
+inline void andNotInto(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t length) {
+    if(length < dispatchThreshold) scalar::andNotInto(dst, a, b, length);
+    else kernels().andNotInto(dst, a, b, length);
+}
+
+inline void orInto(uint64_t* dst, const uint64_t* a, const uint64_t* b, size_t length) {
+    if(length < dispatchThreshold) scalar::orInto(dst, a, b, length);
+    else kernels().orInto(dst, a, b, length);
+}
+
+}
@@ -2,8 +2,9 @@
 
 #include <cstdint>
 #include <iostream>
-#include <fstream>
-#include <limits>
+
+#include <mapped_file.hpp>
+#include <clq_decoder.hpp>
 
 /**
  * Just a dummy graph used to test the parser.
@@ -28,44 +29,37 @@ public:
     ClqParser(const ClqParser&) = delete;
     ~ClqParser() {}
 
+    /**
+     * @brief   Reads only the parameter line, so the caller can pick a graph type before parsing.
+     */
+    ClqDecoder::Header readHeader(const char& fileName) const {
+        MappedFile file(&fileName);
+        ClqDecoder decoder(true);
+
+        auto header = decoder.decodeHeader(file.begin(), file.end());
+        // The body pointer is only valid while the file is mapped.
+        header.body = nullptr;
+        return header;
+    }
+
     template<typename G>
     void parse(const char& fileName, G& graph) const {
-        std::ifstream inputFile(&fileName);
-        if(!inputFile) {
-            throw std::runtime_error("Could not open source file");
-        }
-
-        std::string part;
-        while(inputFile >> part) {
-            switch(part[0]) {
-                // Comment
-                case 'c':
-                    inputFile.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-                    continue;
-                
-                // Parameters
-                case 'p': {
-                    uint32_t numberOfVertices, numberOfEdges;
-                    inputFile >> part;
-                    inputFile >> numberOfVertices;
-                    inputFile >> numberOfEdges;
-                    graph.setParameters(numberOfVertices, numberOfEdges);
-                    break;
-                }
+        MappedFile file(&fileName);
+        // Weighted files (like the ones in project_2/TestData) are accepted, the weights are ignored.
+        ClqDecoder decoder(true);
 
-                // Edges
-                case 'e': {
-                    uint32_t from, to;
-                    inputFile >> from;
-                    inputFile >> to;
-                    graph.addEdge(from, to);
-                    break;
-                }
+        auto header = decoder.decodeHeader(file.begin(), file.end());
+        graph.setParameters(header.numberOfVertices, header.numberOfEdges);
 
-                default: {
-                    throw std::runtime_error(std::string("Unexpected token ") + part[0]);
-                }
+        // Decoding happens in parallel, building the adjacency in one pass afterwards.
+        for(auto& chunk : decoder.decodeBody(header.body, file.end())) {
+            for(auto edge : chunk.edges) {
+                graph.addEdge(edge.from, edge.to);
             }
         }
+
+        if constexpr(requires { graph.finalize(); }) {
+            graph.finalize();
+        }
     }
 };
@@ -0,0 +1,388 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <bit>
+#include <random>
+#include <vector>
+
+#include <bitset.hpp>
+#include <bitset_arena.hpp>
+#include <fixed_bitset.hpp>
+#include <anytime.hpp>
+
+/**
+ * The k-opt local search of Effective Local Search (Katayama et al.), shared by the Effective Local Search solver and
+ * the portfolio mode of Branch and bound. BitSet is FixedBitSet or DynamicBitSet, bit v is vertex v.
+ */
+
+typedef uint32_t vertex;
+
+/**
+ * The rows of the graph the search works with, built once and shared read-only by all starts.
+ */
+template <typename BitSet>
+struct GraphRows
+{
+    template <typename G>
+    explicit GraphRows(const G &graph) : missing_connections(graph.numberOfVertices + 1)
+    {
+        const uint32_t N = graph.numberOfVertices;
+        neighbours.reserve(N + 1);
+        for (vertex v = 0; v <= N; v++)
+        {
+            neighbours.emplace_back(N + 1);
+        }
+
+        // Determine in advance for each node what vertices it is NOT connected to
+        for (vertex v = 1; v <= N; v++)
+        {
+            for (vertex o = 1; o < v; o++)
+            {
+                if (!graph.hasEdge(v, o))
+                {
+                    missing_connections[v].push_back(o);
+                    missing_connections[o].push_back(v);
+                }
+                else
+                {
+                    neighbours[v].insert(o);
+                    neighbours[o].insert(v);
+                }
+            }
+        }
+    }
+
+    // For each vertex this list contains the vertices in the Graph it is NOT connected to, entry 0 is unused.
+    std::vector<std::vector<vertex>> missing_connections;
+    // The neighbours of every vertex as a set, whatever the storage of the graph, for the degrees in possible additions
+    std::vector<BitSet> neighbours;
+};
+
+/**
+ * Bookkeeping of the k-opt local search around the current clique CC, kept up to date by every add or drop move.
+ * A vertex in CC counts as missing itself, so the vertices of CC are one missing as well.
+ */
+template <typename BitSet>
+struct AuxiliarySets
+{
+    AuxiliarySets(uint32_t N, BitSetArena &arena) : possible_additions{N + 1, arena}, missing_count(N + 1), missing_xor(N + 1), drop_score(N + 1), degree_PA(N + 1) {}
+
+    // Set of all nodes that can be added, i.e. nodes missing no edge with CC
+    BitSet possible_additions;
+    // The counters below are indexed by vertex, entry 0 is unused
+    // For each node the amount of vertices in CC it is not connected to
+    std::vector<uint32_t> missing_count;
+    // For each node the XOR of the vertices in CC it is not connected to: the sole missing vertex when the count is 1
+    std::vector<vertex> missing_xor;
+    // For each vertex in CC the amount of one missing nodes that miss only that vertex, so that become possible additions when it is dropped
+    std::vector<uint32_t> drop_score;
+    // The degree of each possible addition in the Graph induced by Possible Additions
+    std::vector<uint32_t> degree_PA;
+};
+
+/**
+ * @brief  Adds a node to the possible additions, its degree is the popcount of its row AND the possible additions and those neighbours get one more
+ * @param  rows: Neighbours and non-neighbours of every vertex
+ * @param  j: The node
+ * @param  aux: The bookkeeping
+ * @retval None
+ */
+template <typename BitSet>
+void enter_possible_additions(const GraphRows<BitSet> &rows, vertex j, AuxiliarySets<BitSet> &aux)
+{
+    const uint64_t *row = rows.neighbours[j].data();
+    const uint64_t *additions = aux.possible_additions.data();
+    uint32_t degree = 0;
+    for (size_t word = 0; word < aux.possible_additions.wordCount(); word++)
+    {
+        uint64_t common = additions[word] & row[word];
+        degree += std::popcount(common);
+        for (; common != 0; common &= common - 1)
+        {
+            aux.degree_PA[(word << 6) + std::countr_zero(common)]++;
+        }
+    }
+    aux.degree_PA[j] = degree;
+    aux.possible_additions.insert(j);
+}
+
+/**
+ * @brief  Removes a node from the possible additions, its neighbours in there get one less
+ * @param  rows: Neighbours and non-neighbours of every vertex
+ * @param  j: The node
+ * @param  aux: The bookkeeping
+ * @retval None
+ */
+template <typename BitSet>
+void leave_possible_additions(const GraphRows<BitSet> &rows, vertex j, AuxiliarySets<BitSet> &aux)
+{
+    aux.possible_additions.erase(j);
+    const uint64_t *row = rows.neighbours[j].data();
+    const uint64_t *additions = aux.possible_additions.data();
+    for (size_t word = 0; word < aux.possible_additions.wordCount(); word++)
+    {
+        for (uint64_t common = additions[word] & row[word]; common != 0; common &= common - 1)
+        {
+            aux.degree_PA[(word << 6) + std::countr_zero(common)]--;
+        }
+    }
+}
+
+/**
+ * @brief  Single step update of the intermediate data structures after a single one-opt add or drop move
+ * @note   Costs the non-neighbours of v, plus one row AND for every node that enters or leaves the possible additions
+ * @param  rows: Neighbours and non-neighbours of every vertex
+ * @param  v: vertex being added or removed from clique
+ * @param  is_add: Is the vertex being added?
+ * @param  aux: The bookkeeping of the current clique
+ * @retval None
+ */
+template <typename BitSet>
+void incremental_update(const GraphRows<BitSet> &rows, vertex v, bool is_add, AuxiliarySets<BitSet> &aux)
+{
+    // v itself and all vertices missing a connection with v
+    auto update = [&](vertex j) {
+        const uint32_t before = aux.missing_count[j];
+        // The sole missing vertex, if any, loses j
+        if (before == 1)
+        {
+            aux.drop_score[aux.missing_xor[j]]--;
+        }
+        aux.missing_xor[j] ^= v;
+        aux.missing_count[j] = is_add ? before + 1 : before - 1;
+
+        if (aux.missing_count[j] == 1)
+        {
+            aux.drop_score[aux.missing_xor[j]]++;
+        }
+        if (is_add && before == 0)
+        {
+            leave_possible_additions(rows, j, aux);
+        }
+        else if (!is_add && before == 1)
+        {
+            enter_possible_additions(rows, j, aux);
+        }
+    };
+
+    update(v);
+    for (vertex j : rows.missing_connections[v])
+    {
+        update(j);
+    }
+}
+
+/**
+ * @brief  This method will recompute the provided auxiliary data structures for a given clique
+ * @note   
+ * @param  graph: Current graph
+ * @param  rows: Neighbours and non-neighbours of every vertex
+ * @param  current_clique: Current clique
+ * @param  aux: The bookkeeping to fill in
+ * @retval None
+ */
+template <typename BitSet, typename G>
+void recompute_auxiliary_sets(const G &graph, const GraphRows<BitSet> &rows, BitSet &current_clique, AuxiliarySets<BitSet> &aux)
+{
+    aux.possible_additions.clear();
+
+    for (vertex v = 1; v <= graph.numberOfVertices; v++)
+    {
+        aux.missing_count[v] = 0;
+        aux.missing_xor[v] = 0;
+        aux.drop_score[v] = 0;
+        aux.degree_PA[v] = 0;
+    }
+
+    // Every vertex of the current clique is missing in itself and in the vertices it is not connected to
+    for (vertex v : current_clique)
+    {
+        aux.missing_count[v]++;
+        aux.missing_xor[v] ^= v;
+        for (vertex n : rows.missing_connections[v])
+        {
+            aux.missing_count[n]++;
+            aux.missing_xor[n] ^= v;
+        }
+    }
+
+    for (vertex v = 1; v <= graph.numberOfVertices; v++)
+    {
+        if (aux.missing_count[v] == 0)
+        {
+            aux.possible_additions.insert(v);
+        }
+        else if (aux.missing_count[v] == 1)
+        {
+            aux.drop_score[aux.missing_xor[v]]++;
+        }
+    }
+
+    // Finally we determine the degree in possible additions
+    for (vertex v : aux.possible_additions)
+    {
+        aux.degree_PA[v] = intersectCount(aux.possible_additions, rows.neighbours[v]);
+    }
+}
+
+/**
+ * @brief  Performs the actual k-opt-local search algorithm
+ * @note   
+ * @param  graph: Graph used during the search
+ * @param  rows: Neighbours and non-neighbours of every vertex
+ * @param  current_clique: Starting clique
+ * @param  aux: Bookkeeping of the starting clique: possible additions, missing counts, drop scores and degrees in the possible additions
+ * @param  arena: Storage for the scratch sets of an iteration
+ * @param  generator: Random numbers for the ties, one stream per start
+ * @param  anytime: Budget of the run, the search stops after the iteration in which it runs out
+ * @retval A resulting clique form the k_opt_local_search
+ */
+template <typename BitSet, typename G>
+BitSet &k_opt_local_search(const G &graph, const GraphRows<BitSet> &rows, BitSet &current_clique, AuxiliarySets<BitSet> &aux, BitSetArena &arena, std::mt19937 &generator, const Anytime &anytime)
+{
+    std::uniform_int_distribution<int> distribution(1, graph.numberOfVertices);
+
+    int g = 0;
+    int g_max = 0;
+
+    // p = {1, .., n}
+    BitSet p{graph.numberOfVertices + 1};
+
+    do
+    {
+        p.fill();
+        p.erase(0);
+        g = 0;
+        g_max = 0;
+
+        // The scratch sets of this iteration live in the arena and are all given back at the end of it.
+        BitSetArena::Scope scope(arena);
+        BitSet previous_clique{current_clique, arena};
+        BitSet d{previous_clique, arena};
+
+        BitSet best_clique{graph.numberOfVertices + 1, arena};
+
+        while (!d.empty())
+        {
+            const bool is_add = intersectsAny(aux.possible_additions, p);
+            vertex m;
+            // if |PA /\ P| > 0
+            if (is_add)
+            { // ADD PHASE
+
+                // Find the v in PA_i_P with maximum induced_degree(graph, PA, v)
+                std::vector<vertex> max_degree;
+                uint32_t maximum = 0;
+                for (vertex v : aux.possible_additions)
+                {
+                    if (!p.contains(v))
+                    {
+                        continue;
+                    }
+                    if (aux.degree_PA[v] == maximum)
+                    {
+                        max_degree.push_back(v);
+                    }
+                    else if (aux.degree_PA[v] > maximum)
+                    {
+                        maximum = aux.degree_PA[v];
+                        max_degree.clear();
+                        max_degree.push_back(v);
+                    }
+                }
+                // Randomly choose vertex with maximum degree
+                int rnd = distribution(generator) % max_degree.size();
+                m = max_degree[rnd];
+
+                current_clique.insert(m);
+                g++;
+                p.erase(m);
+
+                if (g > g_max)
+                {
+                    g_max = g;
+                    best_clique = current_clique;
+                }
+            }
+            else
+            { // DROP PHASE
+
+                // find a v in the intersection of CC and P so that |PA| is maximum, i.e. the v that is the sole missing vertex of the most One Missing items
+                uint32_t maximum = 0;
+                std::vector<vertex> max_occurence;
+
+                for (vertex v : current_clique)
+                {
+                    if (!p.contains(v))
+                    {
+                        continue;
+                    }
+                    const uint32_t frequency = aux.drop_score[v];
+                    if (frequency == maximum)
+                    {
+                        max_occurence.push_back(v);
+                    }
+                    else if (frequency > maximum)
+                    {
+                        max_occurence.clear();
+                        max_occurence.push_back(v);
+                        maximum = frequency;
+                    }
+                }
+                // if multiple vertices, choose one randomly
+                int rnd = distribution(generator) % max_occurence.size();
+                m = max_occurence[rnd];
+
+                current_clique.erase(m);
+                g--;
+                p.erase(m);
+
+                if (previous_clique.contains(m))
+                {
+                    d.erase(m);
+                }
+            }
+            incremental_update(rows, m, is_add, aux);
+        }
+        // Note: When reusing the sets best_clique and previous_clique auxiliary sets have to be recomputed, or stored somewhere temporarily
+        // Copies in place, current_clique keeps its own storage.
+        if (g_max > 0)
+        {
+            current_clique = best_clique;
+        }
+        else
+        {
+            current_clique = previous_clique;
+        }
+        recompute_auxiliary_sets(graph, rows, current_clique, aux);
+    } while (g_max > 0 && !anytime.expired());
+    return current_clique;
+}
+
+/**
+ * @brief  One start of the multi start search: a k-opt local search from a single vertex
+ * @note   The random stream of the start is derived from the seed and the vertex, so a start gives the same clique on any thread
+ * @param  graph: Graph used during the search
+ * @param  rows: Neighbours and non-neighbours of every vertex
+ * @param  v: The start vertex
+ * @param  seed: Seed of the run
+ * @param  current_clique: Storage for the clique, of N + 1 bits
+ * @param  arena: Storage for the scratch sets
+ * @param  generator: Generator of the thread, reseeded for this start
+ * @param  anytime: Budget of the run
+ * @retval The resulting clique, stored in current_clique
+ */
+template <typename BitSet, typename G>
+const BitSet &search_from_vertex(const G &graph, const GraphRows<BitSet> &rows, vertex v, uint64_t seed, BitSet &current_clique, BitSetArena &arena, std::mt19937 &generator, const Anytime &anytime)
+{
+    current_clique.clear();
+    current_clique.insert(v);
+
+    AuxiliarySets<BitSet> aux{graph.numberOfVertices, arena};
+    std::seed_seq stream{(uint32_t)seed, (uint32_t)(seed >> 32), v};
+    generator.seed(stream);
+
+    recompute_auxiliary_sets(graph, rows, current_clique, aux);
+    return k_opt_local_search(graph, rows, current_clique, aux, arena, generator, anytime);
+}
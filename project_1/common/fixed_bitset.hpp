@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <bit>
+#include <type_traits>
+
+#include <bitset.hpp>
+#include <bitset_arena.hpp>
+
+/**
+ * Bitset with the same interface as DynamicBitSet, but with a size fixed at compile time and the words stored inline.
+ * Every loop runs over a constant amount of words, so the compiler unrolls them and small sets stay in registers.
+ */
+template<size_t Words>
+class FixedBitSet {
+public:
+    static constexpr size_t capacity = Words * 64;
+
+    class Iterator {
+    public:
+        Iterator(const FixedBitSet& bitSet) : currentArrayOffset(0), bitSet(&bitSet) {
+            currentArrayItem = bitSet.storage[0];
+            while(currentArrayItem == 0 && currentArrayOffset + 1 < Words) {
+                currentArrayItem = bitSet.storage[++currentArrayOffset];
+            }
+        }
+
+        Iterator(const FixedBitSet& bitSet, size_t offset) : currentArrayItem(0), currentArrayOffset(offset), bitSet(&bitSet) {}
+
+        Iterator& operator++() {
+            currentArrayItem &= currentArrayItem - 1U;
+
+            while(currentArrayItem == 0 && currentArrayOffset + 1 < Words) {
+                currentArrayItem = bitSet->storage[++currentArrayOffset];
+            }
+
+            return *this;
+        }
+
+        uint32_t operator*() const {
+            return __builtin_ctzl(currentArrayItem) + (currentArrayOffset << 6U);
+        }
+
+        bool operator==(const Iterator& y) const {
+            return currentArrayItem == y.currentArrayItem && currentArrayOffset == y.currentArrayOffset;
+        }
+
+        bool operator!=(const Iterator& y) const {
+            return !(*this == y);
+        }
+
+    private:
+        uint64_t currentArrayItem;
+        size_t currentArrayOffset;
+        const FixedBitSet* bitSet;
+    };
+
+    FixedBitSet() : storage {} {}
+
+    FixedBitSet(size_t amountOfBits) : storage {} {
+        assert(amountOfBits <= capacity);
+    }
+
+    // The arena constructors only exist so solvers can be written once for both set types, the words stay inline.
+    FixedBitSet(size_t amountOfBits, BitSetArena&) : FixedBitSet(amountOfBits) {}
+
+    FixedBitSet(const FixedBitSet& other, BitSetArena&) : FixedBitSet(other) {}
+
+    void clear() {
+        for(size_t i = 0; i < Words; ++i) storage[i] = 0;
+    }
+
+    bool empty() const {
+        uint64_t any = 0;
+        for(size_t i = 0; i < Words; ++i) any |= storage[i];
+        return any == 0;
+    }
+
+    void fill() {
+        for(size_t i = 0; i < Words; ++i) storage[i] = -1UL;
+    }
+
+    size_t size() const {
+        size_t count = 0;
+        for(size_t i = 0; i < Words; ++i) count += std::popcount(storage[i]);
+        return count;
+    }
+
+    FixedBitSet intersectionWith(const FixedBitSet& other) const {
+        FixedBitSet ret;
+        for(size_t i = 0; i < Words; ++i) ret.storage[i] = storage[i] & other.storage[i];
+        return ret;
+    }
+
+    FixedBitSet intersectionWith(const FixedBitSet& other, BitSetArena&) const {
+        return intersectionWith(other);
+    }
+
+    uint32_t ffs() const {
+        for(size_t i = 0; i < Words; ++i) {
+            if(storage[i] != 0) {
+                return __builtin_ffsl(storage[i]) - 1 + (i << 6U);
+            }
+        }
+        return -1;
+    }
+
+    uint32_t ffus() const {
+        for(size_t i = 0; i < Words; ++i) {
+            if(storage[i] != -1UL) {
+                return __builtin_ffsl(~storage[i]) - 1 + (i << 6U);
+            }
+        }
+        return -1;
+    }
+
+    void insert(uint32_t bit) {
+        storage[bit >> 6UL] |= 1UL << (bit & 63UL);
+    }
+
+    void insertAll(const FixedBitSet& other) {
+        for(size_t i = 0; i < Words; ++i) storage[i] |= other.storage[i];
+    }
+
+    void erase(uint32_t bit) {
+        storage[bit >> 6UL] &= ~(1UL << (bit & 63UL));
+    }
+
+    void eraseAll(const FixedBitSet& other) {
+        for(size_t i = 0; i < Words; ++i) storage[i] &= ~other.storage[i];
+    }
+
+    bool contains(uint32_t bit) const {
+        return !!(storage[bit >> 6UL] & (1UL << (bit & 63UL)));
+    }
+
+    Iterator begin() const {
+        return { *this };
+    }
+
+    Iterator end() const {
+        return { *this, Words - 1 };
+    }
+
+    uint64_t* data() {
+        return storage;
+    }
+
+    const uint64_t* data() const {
+        return storage;
+    }
+
+    static constexpr size_t wordCount() {
+        return Words;
+    }
+
+    friend size_t intersectCount(const FixedBitSet& a, const FixedBitSet& b) {
+        size_t count = 0;
+        for(size_t i = 0; i < Words; ++i) count += std::popcount(a.storage[i] & b.storage[i]);
+        return count;
+    }
+
+    friend bool intersectsAny(const FixedBitSet& a, const FixedBitSet& b) {
+        uint64_t any = 0;
+        for(size_t i = 0; i < Words; ++i) any |= a.storage[i] & b.storage[i];
+        return any != 0;
+    }
+
+    friend void andNotInto(FixedBitSet& dst, const FixedBitSet& a, const FixedBitSet& b) {
+        for(size_t i = 0; i < Words; ++i) dst.storage[i] = a.storage[i] & ~b.storage[i];
+    }
+
+private:
+    alignas(Words * 8 < 64 ? Words * 8 : 64) uint64_t storage[Words];
+};
+
+/**
+ * @brief   Calls f with std::type_identity of the smallest FixedBitSet of 1, 2, 4, 8 or 16 words that holds
+ *          amountOfBits bits, or of DynamicBitSet for larger sets. Solvers use this once at startup.
+ * @retval  What f returns.
+ */
+template<typename F>
+auto withBitSet(size_t amountOfBits, F&& f) {
+    size_t words = (amountOfBits + 64 - 1) / 64;
+    if(words <= 1) return f(std::type_identity<FixedBitSet<1>>{});
+    if(words <= 2) return f(std::type_identity<FixedBitSet<2>>{});
+    if(words <= 4) return f(std::type_identity<FixedBitSet<4>>{});
+    if(words <= 8) return f(std::type_identity<FixedBitSet<8>>{});
+    if(words <= 16) return f(std::type_identity<FixedBitSet<16>>{});
+    return f(std::type_identity<DynamicBitSet>{});
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <string>
+#include <limits>
+#include <stdexcept>
+
+/**
+ * @brief   Reads a "<prefix><n>" command line argument with a non-negative number, like "--seed=42".
+ * @param argument  The argument
+ * @param prefix    The flag up to and including the '='
+ * @param value     Set to the number when the argument is the flag
+ * @retval  Whether the argument was the flag.
+ * @throws  std::invalid_argument when the number is missing, malformed or too large for the value
+ */
+template<typename T>
+inline bool parseNumberFlag(const char* argument, const char* prefix, T& value) {
+    const size_t length = strlen(prefix);
+    if(strncmp(argument, prefix, length) != 0) {
+        return false;
+    }
+
+    const char* number = argument + length;
+    char* end;
+    errno = 0;
+    unsigned long long parsed = strtoull(number, &end, 10);
+    if(*end != '\0' || end == number || *number == '-' || errno == ERANGE || parsed > std::numeric_limits<T>::max()) {
+        throw std::invalid_argument(std::string("Invalid number in ") + argument);
+    }
+    value = (T) parsed;
+    return true;
+}
@@ -2,25 +2,12 @@
 #include <algorithm>
 #include <numeric>
 #include <cstdint>
+#include <bit>
+#include <vector>
 
 #include <graph.hpp>
 #include <offset_array.hpp>
 
-void Graph::addEdge(uint32_t from, uint32_t to) {
-    auto offset = ref(from - 1, to - 1);
-    offset.ref |= 1UL << offset.bit;
-}
-
-void Graph::removeEdge(uint32_t from, uint32_t to) {
-    auto offset = ref(from - 1, to - 1);
-    offset.ref &= ~(1UL << offset.bit);
-}
-
-bool Graph::hasEdge(uint32_t from, uint32_t to) const {
-    auto offset = ref(from - 1, to - 1);
-    return !!(offset.ref & (1UL << offset.bit));
-}
-
 void Graph::swapEdge(uint32_t from1, uint32_t to1, uint32_t from2, uint32_t to2) {
     bool hasEdge1 = hasEdge(from1, to1);
     bool hasEdge2 = hasEdge(from2, to2);
@@ -55,44 +42,145 @@ float Graph::density() const {
     return 2.0f * ((float) numberOfEdges) / (V * (V - 1.0f));
 }
 
-void Graph::sortByEdgeDensity(uint32_t* actNode, uint32_t* (*finder)(uint32_t*, uint32_t*)) {
-    const uint32_t N = numberOfVertices;
+void Graph::relabel(const uint32_t* order) {
+    induce(order, numberOfVertices);
+}
 
-    // edge[i] gives the amount of edges for node i.
-    uint32_t* edge = new uint32_t[N];
+/**
+ * Adjacency lists of a graph, built once so the orderings and the core decomposition run in O(N + M).
+ */
+struct AdjacencyLists {
+    std::vector<uint32_t> degree;
+    // The neighbours of v are adjacency[offsets[v] .. offsets[v + 1]), all 0-based.
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> adjacency;
+
+    explicit AdjacencyLists(const Graph& graph) : degree(graph.numberOfVertices, 0), offsets(graph.numberOfVertices + 1, 0) {
+        const uint32_t N = graph.numberOfVertices;
+        graph.forEachEdge([&](uint32_t from, uint32_t to) {
+            ++degree[from];
+            ++degree[to];
+        });
+        for(uint32_t v = 0; v < N; ++v) {
+            offsets[v + 1] = offsets[v] + degree[v];
+        }
+        adjacency.resize(offsets[N]);
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        graph.forEachEdge([&](uint32_t from, uint32_t to) {
+            adjacency[fill[from]++] = to;
+            adjacency[fill[to]++] = from;
+        });
+    }
+};
+
+/**
+ * @brief   Peels the graph by repeatedly removing a vertex of minimum degree, with the bucket queue of
+ *          Batagelj & Zaversnik in O(N + M).
+ * @param lists The graph
+ * @param order Set to the vertices in the order they are removed
+ * @retval  The core number of every vertex: its degree when it was removed.
+ */
+static std::vector<uint32_t> peel(const AdjacencyLists& lists, std::vector<uint32_t>& order) {
+    const std::vector<uint32_t>& degree = lists.degree;
+    const uint32_t N = degree.size();
+
+    // order holds the vertices sorted by current degree, bucketStart[d] is the first position with degree d.
+    uint32_t maxDegree = N == 0 ? 0 : *std::max_element(degree.begin(), degree.end());
+    std::vector<uint32_t> bucketStart(maxDegree + 2, 0);
+    for(uint32_t v = 0; v < N; ++v) {
+        ++bucketStart[degree[v] + 1];
+    }
+    for(uint32_t d = 1; d <= maxDegree + 1; ++d) {
+        bucketStart[d] += bucketStart[d - 1];
+    }
+    order.resize(N);
+    std::vector<uint32_t> position(N);
+    std::vector<uint32_t> next(bucketStart.begin(), bucketStart.end() - 1);
+    for(uint32_t v = 0; v < N; ++v) {
+        position[v] = next[degree[v]]++;
+        order[position[v]] = v;
+    }
 
-    // Count amount of edges for each node.
-    for(uint32_t row = 1; row <= N; ++row) {
-        edge[row - 1] = 0;
-        for(uint32_t col = 1; col <= N; ++col) {
-            if(hasEdge(row, col)) {
-                ++edge[row - 1];
+    std::vector<uint32_t> current = degree;
+    for(uint32_t i = 0; i < N; ++i) {
+        uint32_t v = order[i];
+        for(uint32_t k = lists.offsets[v]; k < lists.offsets[v + 1]; ++k) {
+            uint32_t u = lists.adjacency[k];
+            if(current[u] > current[v]) {
+                // Move u to the front of its bucket and shrink that bucket, so u drops one degree.
+                uint32_t du = current[u];
+                uint32_t front = order[bucketStart[du]];
+                std::swap(order[position[u]], order[bucketStart[du]]);
+                std::swap(position[u], position[front]);
+                ++bucketStart[du];
+                --current[u];
             }
         }
     }
+    return current;
+}
 
-    for(uint32_t node = 1; node <= N - 2; ++node) {
-        uint32_t minNode = finder(edge + node - 1, edge + N) - edge;
+std::vector<uint32_t> Graph::coreNumbers() const {
+    std::vector<uint32_t> order;
+    return peel(AdjacencyLists(*this), order);
+}
+
+std::vector<uint32_t> Graph::vertexOrder(VertexOrdering ordering) const {
+    const uint32_t N = numberOfVertices;
+    const AdjacencyLists lists(*this);
+    const std::vector<uint32_t>& degree = lists.degree;
+    const std::vector<uint32_t>& offsets = lists.offsets;
+    const std::vector<uint32_t>& adjacency = lists.adjacency;
+
+    std::vector<uint32_t> order(N);
+    std::iota(order.begin(), order.end(), 0);
+
+    switch(ordering) {
+        case VertexOrdering::DegreeAscending:
+            std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return degree[a] < degree[b]; });
+            break;
+
+        case VertexOrdering::DegreeDescending:
+            std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return degree[a] > degree[b]; });
+            break;
+
+        case VertexOrdering::Degeneracy:
+            peel(lists, order);
+            break;
+
+        case VertexOrdering::Coloring: {
+            std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return degree[a] > degree[b]; });
+
+            // usedBy[c] == v means color c is taken by a neighbour of v.
+            std::vector<uint32_t> color(N, 0);
+            std::vector<uint32_t> usedBy(N + 1, UINT32_MAX);
+            for(uint32_t v : order) {
+                for(uint32_t k = offsets[v]; k < offsets[v + 1]; ++k) {
+                    usedBy[color[adjacency[k]]] = v;
+                }
+                uint32_t c = 1;
+                while(usedBy[c] == v) ++c;
+                color[v] = c;
+            }
 
-        if(node - 1 != minNode) {
-            std::swap(edge[minNode], edge[node - 1]);
-            std::swap(actNode[minNode], actNode[node - 1]);
-            swapVertex(node, minNode + 1);
+            std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return color[a] < color[b]; });
+            break;
         }
     }
 
-    //graph.printAdjacencyMatrix();
-
-    delete[] edge;
+    return order;
 }
 
-OffsetArray<uint32_t, 1> Graph::sortByEdgeDensity(float densityThreshold, uint32_t* (*finder)(uint32_t*, uint32_t*)) {
+OffsetArray<uint32_t, 1> Graph::reorder(VertexOrdering ordering, float densityThreshold) {
     uint32_t* actNode_ = new uint32_t[numberOfVertices];
     std::iota(actNode_, actNode_ + numberOfVertices, 1);
 
-    // Order nodes by increasing edge density.
     if(density() >= densityThreshold) {
-        sortByEdgeDensity(actNode_, finder);
+        std::vector<uint32_t> order = vertexOrder(ordering);
+        relabel(order.data());
+        for(uint32_t i = 0; i < numberOfVertices; ++i) {
+            actNode_[i] = order[i] + 1;
+        }
     }
 
     return { actNode_ };
@@ -107,83 +195,136 @@ void Graph::printAdjacencyMatrix() const {
     }
 }
 
-Graph::StorageOffset Graph2D::ref(uint32_t from, uint32_t to) const {
-    return {
-        .ref = storage[from][to >> 6UL],
-        .bit = to & 63UL
-    };
-}
-
-void Graph2D::setParameters(uint32_t numberOfVertices, uint32_t numberOfEdges) {
+void CsrGraph::setParameters(uint32_t numberOfVertices, uint32_t numberOfEdges) {
     Graph::setParameters(numberOfVertices, numberOfEdges);
 
-    storage = new uint64_t*[numberOfVertices];
-    for(uint32_t i = 0; i < numberOfVertices; ++i) {
-        storage[i] = new uint64_t[(numberOfVertices + 64 - 1) / 64]();
-    }
+    offsets.assign(numberOfVertices + 1, 0);
+    lengths.assign(numberOfVertices, 0);
+    targets.clear();
+    staged.clear();
+    staged.reserve(numberOfEdges);
 }
 
-void Graph2D::addEdge(uint32_t from, uint32_t to) {
-    auto off1 = ref(from - 1, to - 1);
-    auto off2 = ref(to - 1, from - 1);
-    off1.ref |= 1UL << off1.bit;
-    off2.ref |= 1UL << off2.bit;
+void CsrGraph::addEdge(uint32_t from, uint32_t to) {
+    // Self loops carry no information for cliques.
+    if(from != to) {
+        staged.emplace_back(from - 1, to - 1);
+    }
 }
 
-void Graph2D::removeEdge(uint32_t from, uint32_t to) {
-    auto off1 = ref(from - 1, to - 1);
-    auto off2 = ref(to - 1, from - 1);
-    off1.ref &= ~(1UL << off1.bit);
-    off2.ref &= ~(1UL << off2.bit);
+void CsrGraph::removeEdge(uint32_t from, uint32_t to) {
+    auto erase = [&](uint32_t row, uint32_t vertex) {
+        uint32_t* begin = targets.data() + offsets[row];
+        uint32_t* end = begin + lengths[row];
+        uint32_t* it = std::lower_bound(begin, end, vertex);
+        if(it != end && *it == vertex) {
+            std::copy(it + 1, end, it);
+            --lengths[row];
+        }
+    };
+    erase(from - 1, to);
+    erase(to - 1, from);
 }
 
-void Graph2D::printAdjacencyMatrix() const {
-    for(uint32_t i = 1; i <= numberOfVertices; ++i) {
-        for(uint32_t j = 1; j <= numberOfVertices; ++j) {
-            std::cout << (hasEdge(i, j) ? 1 : 0) << " ";
-        }
-        std::cout << std::endl;
+void CsrGraph::finalize() {
+    if(staged.empty()) {
+        return;
     }
-}
 
-Graph::StorageOffset LowerTriangularGraph::ref(uint32_t from, uint32_t to) const {
-    // The largest number is always the row. The smallest number is the column
-    uint64_t offset = from < to ? to * (to + 1) / 2 + from : from * (from + 1) / 2 + to;
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    edges.reserve(targets.size() / 2 + staged.size());
+    forEachEdge([&](uint32_t from, uint32_t to) { edges.emplace_back(from, to); });
+    edges.insert(edges.end(), staged.begin(), staged.end());
+    staged.clear();
+    staged.shrink_to_fit();
 
-    return {
-        .ref = storage[offset >> 6UL],
-        .bit = offset & 63UL,
-    };
+    build(edges);
 }
 
-void LowerTriangularGraph::setParameters(uint32_t numberOfVertices, uint32_t numberOfEdges) {
-    Graph::setParameters(numberOfVertices, numberOfEdges);
+void CsrGraph::build(std::vector<std::pair<uint32_t, uint32_t>>& edges) {
+    const uint32_t N = numberOfVertices;
 
-    // Calculate amount of needed bits
-    size_t amountOfBits = numberOfVertices * (numberOfVertices + 1) / 2;
+    // Counting sort on the row, then sort and deduplicate every row on its own.
+    std::vector<uint64_t> start(N + 1, 0);
+    for(auto [from, to] : edges) {
+        ++start[from + 1];
+        ++start[to + 1];
+    }
+    for(uint32_t v = 0; v < N; ++v) {
+        start[v + 1] += start[v];
+    }
 
-    storage = new uint64_t[(amountOfBits + 64 - 1) / 64]();
+    targets.assign(start[N], 0);
+    std::vector<uint64_t> fill(start.begin(), start.end() - 1);
+    for(auto [from, to] : edges) {
+        targets[fill[from]++] = to + 1;
+        targets[fill[to]++] = from + 1;
+    }
+
+    for(uint32_t v = 0; v < N; ++v) {
+        uint32_t* begin = targets.data() + start[v];
+        uint32_t* end = targets.data() + start[v + 1];
+        std::sort(begin, end);
+        lengths[v] = std::unique(begin, end) - begin;
+    }
+    offsets = std::move(start);
 }
 
-Graph::StorageOffset ListGraph::ref(uint32_t from, uint32_t to) const {
-    if(from < to) {
-        return {
-            .ref = storage[to][from >> 6UL],
-            .bit = from & 63UL,
-        };
-    } else {
-        return {
-            .ref = storage[from][to >> 6UL],
-            .bit = to & 63UL,
-        };
+void CsrGraph::forEachEdge(const std::function<void(uint32_t, uint32_t)>& f) const {
+    for(uint32_t from = 0; from < numberOfVertices; ++from) {
+        // Rows are sorted, so the neighbours below from are a prefix.
+        for(uint32_t to : neighbours(from + 1)) {
+            if(to > from) break;
+            f(from, to - 1);
+        }
     }
 }
 
-void ListGraph::setParameters(uint32_t numberOfVertices, uint32_t numberOfEdges) {
-    Graph::setParameters(numberOfVertices, numberOfEdges);
+void CsrGraph::induce(const uint32_t* order, uint32_t count) {
+    std::vector<uint32_t> position(numberOfVertices, UINT32_MAX);
+    for(uint32_t i = 0; i < count; ++i) {
+        position[order[i]] = i;
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    edges.reserve(targets.size() / 2);
+    forEachEdge([&](uint32_t from, uint32_t to) {
+        if(position[from] != UINT32_MAX && position[to] != UINT32_MAX) {
+            edges.emplace_back(position[from], position[to]);
+        }
+    });
+    numberOfVertices = count;
+    numberOfEdges = edges.size();
+    lengths.assign(count, 0);
+    build(edges);
+}
+
+CoreReduction::CoreReduction(uint32_t numberOfVertices, uint32_t threshold) : actNode(numberOfVertices), threshold(std::max(threshold, 1U)) {
+    std::iota(actNode.begin(), actNode.end(), 1);
+}
+
+bool CoreReduction::update(Graph& graph, uint32_t cliqueSize) {
+    if(!due(cliqueSize)) {
+        return false;
+    }
+    peeledFor = cliqueSize;
+
+    // A peel keeps the core numbers of the vertices it leaves, so peeling the peeled graph is the same as peeling the original.
+    std::vector<uint32_t> core = graph.coreNumbers();
+    std::vector<uint32_t> kept;
+    for(uint32_t v = 0; v < graph.numberOfVertices; ++v) {
+        if(core[v] >= cliqueSize - 1) {
+            kept.push_back(v);
+        }
+    }
+    if(kept.size() == graph.numberOfVertices) {
+        return false;
+    }
 
-    storage = new uint64_t*[numberOfVertices];
-    for(uint32_t i = 0; i < numberOfVertices; ++i) {
-        storage[i] = new uint64_t[((i + 1) + 64 - 1) / 64]();
+    graph.induce(kept.data(), kept.size());
+    for(uint32_t i = 0; i < kept.size(); ++i) {
+        actNode[i] = actNode[kept[i]];
     }
+    actNode.resize(kept.size());
+    return true;
 }
@@ -1,16 +1,53 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <functional>
+#include <vector>
+#include <span>
+#include <bit>
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include <iostream>
 
 template<typename T, size_t O>
 class OffsetArray;
+class MappedFile;
+
+enum class VertexOrdering {
+    // Increasing / decreasing degree.
+    DegreeAscending,
+    DegreeDescending,
+    // Degeneracy (min-width) order: the order in which repeatedly removing a vertex of minimum degree peels the graph.
+    Degeneracy,
+    // Greedy sequential coloring in decreasing degree order, then sorted by color class, as used by MCQ/MCS.
+    Coloring,
+};
+
+/**
+ * @brief   Calls f(i) for every set bit i in [begin, end) of the given words, with i relative to begin.
+ */
+template<typename F>
+inline void forEachSetBit(const uint64_t* words, uint64_t begin, uint64_t end, F f) {
+    for(uint64_t word = begin >> 6UL, lastWord = (end + 63UL) >> 6UL; word < lastWord; ++word) {
+        uint64_t bits = words[word];
+        // Mask off the bits outside of [begin, end) in the first and last word.
+        if(word == begin >> 6UL) bits &= -1UL << (begin & 63UL);
+        if(word == (end - 1) >> 6UL && (end & 63UL) != 0) bits &= (1UL << (end & 63UL)) - 1;
+
+        while(bits != 0) {
+            f((word << 6UL) + std::countr_zero(bits) - begin);
+            bits &= bits - 1;
+        }
+    }
+}
 
 class Graph {
 protected:
-    struct StorageOffset {
-        uint64_t& ref;
-        uint64_t bit;
-    };
+    // Keeps a memory mapped snapshot alive while the storage points into it, see graph_snapshot.hpp.
+    std::shared_ptr<MappedFile> snapshot;
 
 public:
     uint32_t numberOfVertices { 0 };
@@ -20,88 +57,346 @@ public:
     Graph(const Graph&) = delete;
     virtual ~Graph() {}
 
-    virtual StorageOffset ref(uint32_t, uint32_t) const = 0;
-
     virtual void setParameters(uint32_t numberOfVertices, uint32_t numberOfEdges) {
         this->numberOfVertices = numberOfVertices;
         this->numberOfEdges = numberOfEdges;
     }
 
-    virtual void addEdge(uint32_t from, uint32_t to);
-    virtual void removeEdge(uint32_t from, uint32_t to);
-    bool hasEdge(uint32_t from, uint32_t to) const;
+    // Solvers are templates over the concrete (final) graph type, so these calls are resolved statically there.
+    // Going through Graph& is meant for the setup code only.
+    virtual void addEdge(uint32_t from, uint32_t to) = 0;
+    virtual void removeEdge(uint32_t from, uint32_t to) = 0;
+    virtual bool hasEdge(uint32_t from, uint32_t to) const = 0;
+    // Called by the parsers once every edge has been added.
+    virtual void finalize() {}
     void swapEdge(uint32_t from1, uint32_t to1, uint32_t from2, uint32_t to2);
     void swapVertex(uint32_t a, uint32_t b);
     float density() const;
-    void sortByEdgeDensity(uint32_t* actNode, uint32_t* (*finder)(uint32_t*, uint32_t*));
-    OffsetArray<uint32_t, 1> sortByEdgeDensity(float densityThreshold, uint32_t* (*finder)(uint32_t*, uint32_t*));
+
+    // Calls f(from, to) once for every edge, with 0-based vertices and to < from.
+    virtual void forEachEdge(const std::function<void(uint32_t, uint32_t)>& f) const = 0;
+    // Keeps only count vertices and the edges between them, in one pass. order[i] is the 0-based old index of the
+    // vertex that gets index i.
+    virtual void induce(const uint32_t* order, uint32_t count) = 0;
+    // Renumbers all vertices in one pass, order[i] is the 0-based old index of the vertex that gets index i.
+    void relabel(const uint32_t* order);
+    std::vector<uint32_t> vertexOrder(VertexOrdering ordering) const;
+    // Core number of every 0-based vertex: the largest k for which it is in the k-core, the largest subgraph in which
+    // every vertex has at least k neighbours.
+    std::vector<uint32_t> coreNumbers() const;
+    OffsetArray<uint32_t, 1> reorder(VertexOrdering ordering, float densityThreshold = 0.0f);
     virtual void printAdjacencyMatrix() const;
 };
 
-class Graph2D final : public Graph {
-protected:
-    Graph::StorageOffset ref(uint32_t from, uint32_t to) const override;
+/**
+ * Storage layouts for StorageGraph. A layout maps a 0-based vertex pair to a bit in one of its rows of words.
+ * For every vertex, the bits of its pairs with all lower vertices form one contiguous range starting at locate(v, 0).
+ */
+struct BitPosition {
+    uint32_t row;
+    uint64_t bit;
+};
+
+// Full N x N matrix, every edge is stored in both directions so a row is the complete neighbourhood.
+struct MatrixLayout {
+    static constexpr uint32_t snapshotLayout = 1;
+    static constexpr const char* snapshotName = "2d";
+    static constexpr bool symmetric = true;
+
+    static uint32_t rows(uint32_t numberOfVertices) { return numberOfVertices; }
+    static size_t rowWords(uint32_t numberOfVertices, uint32_t) { return (numberOfVertices + 64 - 1) / 64; }
+    static BitPosition locate(uint32_t from, uint32_t to) { return { from, to }; }
+};
+
+// Lower triangle (diagonal included) in one bit array, row after row.
+struct LowerTriangularLayout {
+    static constexpr uint32_t snapshotLayout = 2;
+    static constexpr const char* snapshotName = "lower";
+    static constexpr bool symmetric = false;
+
+    static uint32_t rows(uint32_t) { return 1; }
+    static size_t rowWords(uint32_t numberOfVertices, uint32_t) { return ((size_t) numberOfVertices * (numberOfVertices + 1) / 2 + 64 - 1) / 64; }
+    static BitPosition locate(uint32_t from, uint32_t to) {
+        // The largest number is always the row. The smallest number is the column
+        if(from < to) std::swap(from, to);
+        return { 0, (uint64_t) from * (from + 1) / 2 + to };
+    }
+};
+
+// Lower triangle with a separate allocation per row.
+struct ListLayout {
+    static constexpr uint32_t snapshotLayout = 3;
+    static constexpr const char* snapshotName = "list";
+    static constexpr bool symmetric = false;
+
+    static uint32_t rows(uint32_t numberOfVertices) { return numberOfVertices; }
+    static size_t rowWords(uint32_t, uint32_t row) { return ((row + 1) + 64 - 1) / 64; }
+    static BitPosition locate(uint32_t from, uint32_t to) {
+        if(from < to) std::swap(from, to);
+        return { from, to };
+    }
+};
 
+/**
+ * Bit matrix graph with the storage layout as a policy. The class is final and the edge operations are defined
+ * here, so code that knows the concrete type gets them inlined instead of going through the vtable.
+ */
+template<typename Layout>
+class StorageGraph final : public Graph {
+protected:
     uint64_t** storage {nullptr};
 
+    uint64_t& word(BitPosition position) const {
+        return storage[position.row][position.bit >> 6UL];
+    }
+
 public:
-    Graph2D() {}
-    ~Graph2D() { 
-        for(uint32_t i = 0; i < numberOfVertices; ++i) {
+    static constexpr uint32_t snapshotLayout = Layout::snapshotLayout;
+    static constexpr const char* snapshotName = Layout::snapshotName;
+
+    StorageGraph() {}
+    ~StorageGraph() {
+        for(uint32_t i = 0; storage != nullptr && i < Layout::rows(numberOfVertices) && !snapshot; ++i) {
             delete[] storage[i];
         }
 
         delete[] storage;
     }
-    
-    void setParameters(uint32_t numberOfVertices, uint32_t numberOfEdges) override;
-    void addEdge(uint32_t from, uint32_t to) override;
-    void removeEdge(uint32_t from, uint32_t to) override;
-    void printAdjacencyMatrix() const override;
 
-    uint64_t degree(uint32_t node) const {
+    static uint32_t storageRows(uint32_t numberOfVertices) { return Layout::rows(numberOfVertices); }
+    static size_t storageRowWords(uint32_t numberOfVertices, uint32_t row) { return Layout::rowWords(numberOfVertices, row); }
+    const uint64_t* storageRow(uint32_t row) const { return storage[row]; }
+
+    void adoptStorage(uint32_t numberOfVertices, uint32_t numberOfEdges, uint64_t** rows, std::shared_ptr<MappedFile> snapshot) {
+        Graph::setParameters(numberOfVertices, numberOfEdges);
+        this->snapshot = std::move(snapshot);
+        storage = rows;
+    }
+
+    void setParameters(uint32_t numberOfVertices, uint32_t numberOfEdges) override {
+        Graph::setParameters(numberOfVertices, numberOfEdges);
+
+        storage = new uint64_t*[Layout::rows(numberOfVertices)];
+        for(uint32_t i = 0; i < Layout::rows(numberOfVertices); ++i) {
+            storage[i] = new uint64_t[Layout::rowWords(numberOfVertices, i)]();
+        }
+    }
+
+    void addEdge(uint32_t from, uint32_t to) override {
+        auto position = Layout::locate(from - 1, to - 1);
+        word(position) |= 1UL << (position.bit & 63UL);
+        if constexpr(Layout::symmetric) {
+            auto mirrored = Layout::locate(to - 1, from - 1);
+            word(mirrored) |= 1UL << (mirrored.bit & 63UL);
+        }
+    }
+
+    void removeEdge(uint32_t from, uint32_t to) override {
+        auto position = Layout::locate(from - 1, to - 1);
+        word(position) &= ~(1UL << (position.bit & 63UL));
+        if constexpr(Layout::symmetric) {
+            auto mirrored = Layout::locate(to - 1, from - 1);
+            word(mirrored) &= ~(1UL << (mirrored.bit & 63UL));
+        }
+    }
+
+    bool hasEdge(uint32_t from, uint32_t to) const override {
+        auto position = Layout::locate(from - 1, to - 1);
+        return (word(position) >> (position.bit & 63UL)) & 1UL;
+    }
+
+    void forEachEdge(const std::function<void(uint32_t, uint32_t)>& f) const override {
+        for(uint32_t from = 0; from < numberOfVertices; ++from) {
+            auto first = Layout::locate(from, 0);
+            forEachSetBit(storage[first.row], first.bit, first.bit + from, [&](uint64_t to) { f(from, to); });
+        }
+    }
+
+    void induce(const uint32_t* order, uint32_t count) override {
+        std::vector<uint32_t> position(numberOfVertices, UINT32_MAX);
+        for(uint32_t i = 0; i < count; ++i) {
+            position[order[i]] = i;
+        }
+
+        StorageGraph induced;
+        induced.setParameters(count, 0);
+        uint32_t edges = 0;
+        forEachEdge([&](uint32_t from, uint32_t to) {
+            if(position[from] != UINT32_MAX && position[to] != UINT32_MAX) {
+                induced.addEdge(position[from] + 1, position[to] + 1);
+                ++edges;
+            }
+        });
+        std::swap(storage, induced.storage);
+        // If the old rows live in a snapshot, the snapshot must go with them, and they are freed by their own count.
+        std::swap(snapshot, induced.snapshot);
+        std::swap(numberOfVertices, induced.numberOfVertices);
+        numberOfEdges = edges;
+    }
+
+    void printAdjacencyMatrix() const override {
+        for(uint32_t i = 1; i <= numberOfVertices; ++i) {
+            for(uint32_t j = 1; j <= (Layout::symmetric ? numberOfVertices : i); ++j) {
+                std::cout << (hasEdge(i, j) ? 1 : 0) << " ";
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    uint64_t degree(uint32_t node) const requires Layout::symmetric {
         uint32_t amountOfBitVectors = (numberOfVertices + 64 - 1) / 64;
 
         uint32_t degree = 0;
         for(uint32_t i = 0; i < amountOfBitVectors; ++i) {
-            degree += __builtin_popcount(storage[node - 1][i]);
+            degree += __builtin_popcountll(storage[node - 1][i]);
         }
         return degree;
     }
 
-    const uint64_t* neighbours(uint32_t from) const {
+    const uint64_t* neighbours(uint32_t from) const requires Layout::symmetric {
         return storage[from - 1];
     }
 };
 
-class LowerTriangularGraph final : public Graph {
+typedef StorageGraph<MatrixLayout> Graph2D;
+typedef StorageGraph<LowerTriangularLayout> LowerTriangularGraph;
+typedef StorageGraph<ListLayout> ListGraph;
+
+/**
+ * @brief   Copies the edges of any graph into full neighbour rows, for the code that works on those.
+ * @param graph The graph
+ * @param rows  Gets the same vertices and edges, must be empty
+ */
+inline void copyToRows(const Graph& graph, Graph2D& rows) {
+    rows.setParameters(graph.numberOfVertices, graph.numberOfEdges);
+    graph.forEachEdge([&](uint32_t from, uint32_t to) {
+        rows.addEdge(from + 1, to + 1);
+    });
+}
+
+/**
+ * Compressed sparse row storage: the sorted neighbours of every vertex, one after the other.
+ * Takes 8 bytes per edge instead of N² bits, so graphs with millions of vertices fit as long as they are sparse.
+ * Edges are staged until finalize(), hasEdge() only sees finalized edges.
+ * Can't be loaded from a snapshot.
+ */
+class CsrGraph final : public Graph {
 protected:
-    Graph::StorageOffset ref(uint32_t from, uint32_t to) const override;
+    // The neighbours of vertex v + 1 are targets[offsets[v] .. offsets[v] + lengths[v]), sorted and 1-based.
+    // removeEdge shortens a row in place, so lengths[v] can be less than offsets[v + 1] - offsets[v].
+    std::vector<uint64_t> offsets;
+    std::vector<uint32_t> lengths;
+    std::vector<uint32_t> targets;
+    // Edges added since the last finalize(), 0-based.
+    std::vector<std::pair<uint32_t, uint32_t>> staged;
 
-    uint64_t* storage {nullptr};
+    void build(std::vector<std::pair<uint32_t, uint32_t>>& edges);
 
 public:
-    LowerTriangularGraph() {}
-    ~LowerTriangularGraph() { delete[] storage; }
+    // Below this density CSR takes less memory than the bit matrices and the binary search stays short.
+    static constexpr float densityThreshold = 0.01f;
+
+    /**
+     * @brief   Whether a graph with the given parameters should be stored as CSR.
+     */
+    static bool suits(uint32_t numberOfVertices, uint32_t numberOfEdges) {
+        float V = (float) numberOfVertices;
+        return numberOfVertices > 1 && 2.0f * ((float) numberOfEdges) / (V * (V - 1.0f)) < densityThreshold;
+    }
+
+    CsrGraph() {}
+    ~CsrGraph() {}
 
     void setParameters(uint32_t numberOfVertices, uint32_t numberOfEdges) override;
-};
+    void addEdge(uint32_t from, uint32_t to) override;
+    void removeEdge(uint32_t from, uint32_t to) override;
+    void finalize() override;
+    void forEachEdge(const std::function<void(uint32_t, uint32_t)>& f) const override;
+    void induce(const uint32_t* order, uint32_t count) override;
 
-class ListGraph final : public Graph {
-protected:
-    Graph::StorageOffset ref(uint32_t from, uint32_t to) const override;
+    uint32_t degree(uint32_t node) const {
+        return lengths[node - 1];
+    }
 
-    uint64_t** storage {nullptr};
+    // Sorted, 1-based neighbours of the given vertex.
+    std::span<const uint32_t> neighbours(uint32_t from) const {
+        return { targets.data() + offsets[from - 1], lengths[from - 1] };
+    }
 
-public:
-    ListGraph() {}
-    ~ListGraph() {
-        for(uint32_t i = 0; i < numberOfVertices; ++i) {
-            delete[] storage[i];
+    bool hasEdge(uint32_t from, uint32_t to) const override {
+        // Search the shorter of the two rows.
+        if(lengths[from - 1] > lengths[to - 1]) {
+            std::swap(from, to);
         }
+        auto row = neighbours(from);
+        return std::binary_search(row.begin(), row.end(), to);
+    }
+};
 
-        delete[] storage;
+/**
+ * Incumbent-driven k-core preprocessing for maximum clique.
+ *
+ * Every vertex of a clique of size s has s - 1 neighbours in it, so all cliques of size s or more lie in the
+ * (s - 1)-core. Once a clique of size s, or a lower bound s on the clique number, is known, the vertices outside that
+ * core are dropped and the rest is renumbered 1..n in its old relative order. As the incumbent grows the graph is
+ * peeled again, but only once it grew by the threshold since the last peel: every peel copies the graph.
+ */
+class CoreReduction final {
+public:
+    /**
+     * @param numberOfVertices  Vertices of the graph before the first peel
+     * @param threshold         How much the clique size has to grow before the graph is peeled again, at least 1
+     */
+    explicit CoreReduction(uint32_t numberOfVertices, uint32_t threshold = 1);
+
+    /**
+     * @brief   Peels the graph to the (cliqueSize - 1)-core, if cliqueSize grew by the threshold since the last peel.
+     * @param graph         The graph, as left by the previous peel
+     * @param cliqueSize    Size of the cliques that have to be kept
+     * @retval  Whether vertices were removed.
+     */
+    bool update(Graph& graph, uint32_t cliqueSize);
+
+    /**
+     * @brief   Whether cliqueSize grew by the threshold since the last peel, so update would peel again.
+     */
+    bool due(uint32_t cliqueSize) const {
+        return cliqueSize >= 2 && cliqueSize >= peeledFor + threshold;
     }
 
-    void setParameters(uint32_t numberOfVertices, uint32_t numberOfEdges) override;
+    /**
+     * @brief   Vertex of the original graph, 1-based, of the vertex v of the peeled graph, 1-based.
+     */
+    uint32_t original(uint32_t v) const {
+        return actNode[v - 1];
+    }
+
+private:
+    // The original vertex of every vertex left, both 1-based.
+    std::vector<uint32_t> actNode;
+    uint32_t threshold;
+    // Clique size of the last peel, 0 before the first one.
+    uint32_t peeledFor { 0 };
 };
+
+/**
+ * @brief   Builds a clique greedily, taking every vertex that is adjacent to all vertices taken so far. The vertices
+ *          are tried in decreasing core number, a large clique lies in a deep core even when its degrees are average.
+ * @param graph The graph
+ * @retval  Size of the clique, a lower bound for the max clique size
+ */
+template<typename G>
+uint32_t greedyCliqueSize(const G& graph) {
+    std::vector<uint32_t> core = graph.coreNumbers();
+    std::vector<uint32_t> order(graph.numberOfVertices);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return core[a] > core[b]; });
+
+    std::vector<uint32_t> clique;
+    for(uint32_t v : order) {
+        if(std::all_of(clique.begin(), clique.end(), [&](uint32_t u) { return graph.hasEdge(v + 1, u + 1); })) {
+            clique.push_back(v);
+        }
+    }
+    return clique.size();
+}
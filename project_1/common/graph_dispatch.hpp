@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstring>
+#include <string>
+#include <stdexcept>
+
+#include <graph.hpp>
+#include <graph_snapshot.hpp>
+
+/**
+ * Graph storage backends that can be picked at startup with "--graph=<layout>".
+ * Auto stores sparse graphs (see CsrGraph::suits) as CSR and everything else in the solver's default dense layout.
+ */
+enum class GraphLayout {
+    Auto,
+    Matrix,
+    LowerTriangular,
+    List,
+    Csr,
+};
+
+/**
+ * @brief   Reads a "--graph=<layout>" command line argument.
+ * @param argument  The argument
+ * @param layout    Set to the layout named by the argument
+ * @retval  Whether the argument was a layout flag.
+ */
+inline bool parseGraphLayout(const char* argument, GraphLayout& layout) {
+    static constexpr const char prefix[] = "--graph=";
+    if(strncmp(argument, prefix, sizeof(prefix) - 1) != 0) {
+        return false;
+    }
+
+    std::string name(argument + sizeof(prefix) - 1);
+    if(name == "auto") {
+        layout = GraphLayout::Auto;
+    } else if(name == Graph2D::snapshotName) {
+        layout = GraphLayout::Matrix;
+    } else if(name == LowerTriangularGraph::snapshotName) {
+        layout = GraphLayout::LowerTriangular;
+    } else if(name == ListGraph::snapshotName) {
+        layout = GraphLayout::List;
+    } else if(name == "csr") {
+        layout = GraphLayout::Csr;
+    } else {
+        throw std::invalid_argument("Unknown graph layout " + name + ", expected auto, 2d, lower, list or csr");
+    }
+    return true;
+}
+
+/**
+ * @brief   Loads the graph in the requested layout and calls run(graph) with the concrete graph type.
+ *          This is the only place the layout is looked at, the solver itself is compiled once per layout.
+ * @param layout        Requested layout
+ * @param denseLayout   Layout used by Auto for graphs that are not sparse
+ * @param fileName      Source file
+ * @param run           Generic callable, gets the loaded graph
+ * @retval  What run returns.
+ */
+template<typename Parser, typename F>
+auto withGraph(GraphLayout layout, GraphLayout denseLayout, const char& fileName, F&& run) {
+    GraphCache<Parser> cache;
+
+    if(layout == GraphLayout::Auto) {
+        auto header = Parser().readHeader(fileName);
+        layout = CsrGraph::suits(header.numberOfVertices, header.numberOfEdges) ? GraphLayout::Csr : denseLayout;
+    }
+
+    switch(layout) {
+        case GraphLayout::Matrix: {
+            Graph2D graph;
+            cache.load(fileName, graph);
+            return run(graph);
+        }
+
+        case GraphLayout::List: {
+            ListGraph graph;
+            cache.load(fileName, graph);
+            return run(graph);
+        }
+
+        case GraphLayout::Csr: {
+            // There is no snapshot format for CSR.
+            CsrGraph graph;
+            Parser().parse(fileName, graph);
+            return run(graph);
+        }
+
+        case GraphLayout::LowerTriangular:
+        default: {
+            LowerTriangularGraph graph;
+            cache.load(fileName, graph);
+            return run(graph);
+        }
+    }
+}
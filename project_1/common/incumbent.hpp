@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <utility>
+
+/**
+ * Best solution found so far, shared between the threads of a search.
+ *
+ * The size is an atomic that every thread reads in its bounds, so a better solution found by one thread prunes
+ * the others from their next bound check on. Reading it is a plain load. The solution itself is only touched
+ * under the mutex, when a thread improves it, and once all threads are done.
+ */
+template<typename Solution>
+class Incumbent final {
+public:
+    Incumbent() : bestSize(0) {}
+
+    Incumbent(const Incumbent&) = delete;
+
+    /**
+     * @brief   Size of the best solution so far, 0 if there is none yet.
+     */
+    inline uint32_t size() const {
+        return bestSize.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief   Replaces the best solution if the offered one is larger.
+     * @param size  Size of the offered solution
+     * @param store Called as store(solution) under the lock to write the new solution, only when it is an improvement
+     * @retval  Whether the offer was an improvement.
+     */
+    template<typename F>
+    bool offer(uint32_t size, F&& store) {
+        if(size <= this->size()) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if(size <= bestSize.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        store(solution);
+        bestSize.store(size, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief   Reads the best solution while other threads may still offer solutions.
+     * @param load  Called as load(solution) under the lock, to copy out what it needs
+     */
+    template<typename F>
+    void read(F&& load) {
+        std::lock_guard<std::mutex> lock(mutex);
+        load(static_cast<const Solution&>(solution));
+    }
+
+    /**
+     * @brief   The best solution, only to be used once the threads that offer solutions have stopped.
+     */
+    Solution& get() {
+        return solution;
+    }
+
+private:
+    std::atomic<uint32_t> bestSize;
+    std::mutex mutex;
+    Solution solution;
+};
@@ -17,6 +17,9 @@ public:
     OffsetArray(OffsetArray&& other) noexcept : storage(std::exchange(other.storage, nullptr)) {}
 
     OffsetArray& operator=(OffsetArray&& other) {
+        if(storage != nullptr) {
+            delete[] (storage + O);
+        }
         storage = std::exchange(other.storage, nullptr);
         return *this;
     }
@@ -33,6 +36,10 @@ public:
         return storage[index];
     }
 
+    inline const T& operator[](size_t index) const {
+        return storage[index];
+    }
+
     inline T* ptr() {
         return (storage + O);
     }
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <initializer_list>
+
+/**
+ * Statistics of a search tree: nodes expanded per depth, prunes per bound, incumbent updates with the time they were
+ * found, time-to-best and time-to-proof.
+ *
+ * Only collected when compiled with -DSEARCH_STATS ("make stats"). Otherwise every method is an empty inline function
+ * and the calls in the solvers compile to nothing, so the release build stays as fast as it was.
+ *
+ * The bounds a solver prunes on are numbered by the solver itself, the names given to the constructor are used
+ * for the JSON report in the same order.
+ */
+#ifdef SEARCH_STATS
+
+class SearchStats final {
+public:
+    static constexpr bool enabled = true;
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Incumbent {
+        uint64_t value;
+        double seconds;
+    };
+
+    SearchStats(const char* solver, std::initializer_list<const char*> pruneNames)
+        : solver(solver), pruneNames(pruneNames), prunes(pruneNames.size(), 0), start(Clock::now()) {}
+
+    /**
+     * @brief   Counts a node of the search tree being expanded.
+     * @param depth Depth of the node, the root is depth 0 or 1 depending on the solver
+     */
+    inline void node(uint32_t depth) {
+        if(depth >= nodes.size()) {
+            nodes.resize(depth + 1, 0);
+        }
+        ++nodes[depth];
+    }
+
+    /**
+     * @brief   Counts a subtree that was cut off.
+     * @param bound Index of the bound in the names given to the constructor
+     */
+    inline void prune(uint32_t bound) {
+        ++prunes[bound];
+    }
+
+    /**
+     * @brief   Records a new incumbent with the time since the search started.
+     * @param value Size or weight of the new incumbent
+     */
+    inline void incumbent(uint64_t value) {
+        incumbents.push_back({ value, elapsed() });
+    }
+
+    /**
+     * @brief   Records the moment the search proved its incumbent optimal (or simply ended, for heuristics).
+     */
+    inline void proof() {
+        proofSeconds = elapsed();
+    }
+
+    /**
+     * @brief   Empty statistics with the same bounds and start time, for one thread of a parallel search.
+     */
+    SearchStats fork() const {
+        SearchStats other(*this);
+        other.prunes.assign(prunes.size(), 0);
+        other.nodes.clear();
+        other.incumbents.clear();
+        return other;
+    }
+
+    /**
+     * @brief   Adds the statistics of one thread of a parallel search.
+     */
+    void merge(const SearchStats& other) {
+        if(other.nodes.size() > nodes.size()) {
+            nodes.resize(other.nodes.size(), 0);
+        }
+        for(size_t depth = 0; depth < other.nodes.size(); ++depth) {
+            nodes[depth] += other.nodes[depth];
+        }
+        for(size_t bound = 0; bound < prunes.size(); ++bound) {
+            prunes[bound] += other.prunes[bound];
+        }
+        incumbents.insert(incumbents.end(), other.incumbents.begin(), other.incumbents.end());
+        std::sort(incumbents.begin(), incumbents.end(), [](const Incumbent& a, const Incumbent& b) { return a.seconds < b.seconds; });
+    }
+
+    /**
+     * @brief   Writes the statistics as a JSON object.
+     * @param fileName  Output file, overwritten
+     */
+    void writeJson(const std::string& fileName) const {
+        std::ofstream out(fileName);
+        if(!out) {
+            throw std::runtime_error("Cannot open " + fileName + " for writing");
+        }
+
+        uint64_t totalNodes = 0;
+        for(uint64_t count : nodes) {
+            totalNodes += count;
+        }
+
+        out << "{\n";
+        out << "  \"solver\": \"" << solver << "\",\n";
+        out << "  \"nodes\": " << totalNodes << ",\n";
+        out << "  \"nodesPerDepth\": [";
+        for(size_t depth = 0; depth < nodes.size(); ++depth) {
+            out << (depth == 0 ? "" : ", ") << nodes[depth];
+        }
+        out << "],\n";
+        out << "  \"prunes\": {";
+        for(size_t bound = 0; bound < prunes.size(); ++bound) {
+            out << (bound == 0 ? "" : ", ") << "\"" << pruneNames[bound] << "\": " << prunes[bound];
+        }
+        out << "},\n";
+        out << "  \"incumbents\": [";
+        for(size_t i = 0; i < incumbents.size(); ++i) {
+            out << (i == 0 ? "" : ", ") << "{ \"value\": " << incumbents[i].value << ", \"seconds\": " << incumbents[i].seconds << " }";
+        }
+        out << "],\n";
+        out << "  \"timeToBest\": " << (incumbents.empty() ? 0.0 : incumbents.back().seconds) << ",\n";
+        out << "  \"timeToProof\": " << proofSeconds << "\n";
+        out << "}\n";
+
+        if(!out) {
+            throw std::runtime_error("Failed writing " + fileName);
+        }
+    }
+
+private:
+    inline double elapsed() const {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    const char* solver;
+    std::vector<const char*> pruneNames;
+    std::vector<uint64_t> prunes;
+    std::vector<uint64_t> nodes;
+    std::vector<Incumbent> incumbents;
+    double proofSeconds = 0.0;
+    Clock::time_point start;
+};
+
+#else
+
+class SearchStats final {
+public:
+    static constexpr bool enabled = false;
+
+    SearchStats(const char*, std::initializer_list<const char*>) {}
+
+    inline void node(uint32_t) {}
+
+    inline void prune(uint32_t) {}
+
+    inline void incumbent(uint64_t) {}
+
+    inline void proof() {}
+
+    SearchStats fork() const { return *this; }
+
+    void merge(const SearchStats&) {}
+
+    void writeJson(const std::string&) const {}
+};
+
+#endif
+
+/**
+ * @brief   Takes "--stats=<file>" out of the command line arguments.
+ * @param argument  Argument to check
+ * @param fileName  Set to the output file when the argument is the stats flag
+ * @retval  True if the argument was the stats flag
+ * @throws  std::invalid_argument when the solver was built without SEARCH_STATS
+ */
+inline bool parseStatsFlag(const char* argument, std::string& fileName) {
+    const std::string flag = "--stats=";
+    if(std::string(argument).rfind(flag, 0) != 0) {
+        return false;
+    }
+    if(!SearchStats::enabled) {
+        throw std::invalid_argument("Search statistics are compiled out, use main_stats from \"make stats\" for --stats");
+    }
+    fileName = argument + flag.size();
+    if(fileName.empty()) {
+        throw std::invalid_argument("--stats needs an output file");
+    }
+    return true;
+}
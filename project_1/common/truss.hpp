@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include <graph.hpp>
+#include <bitset_kernels.hpp>
+
+/**
+ * Edge-level pruning for maximum clique. Every edge of a clique of size s lies in s - 2 triangles of that clique, so an
+ * edge in fewer triangles can't be in such a clique and is removed. That takes triangles away from the edges it
+ * formed them with, so edges are peeled until every edge left has the support: the s-truss.
+ *
+ * The support of an edge {u, v} is the amount of common neighbours, one AND and popcount of the rows of u and v
+ * with the vectorized kernels, so the graph has to be a Graph2D.
+ */
+
+/**
+ * @brief   Peels the graph to its cliqueSize-truss, every clique of cliqueSize vertices or more is kept.
+ * @param graph         The graph, the edges outside the truss are removed from it
+ * @param cliqueSize    Size of the cliques that have to be kept
+ * @retval  Amount of edges removed.
+ */
+inline uint32_t peelTruss(Graph2D& graph, uint32_t cliqueSize) {
+    if(cliqueSize < 3) {
+        return 0;
+    }
+    const uint32_t N = graph.numberOfVertices;
+    const uint32_t minSupport = cliqueSize - 2;
+    const size_t words = (N + 64 - 1) / 64;
+
+    // Every edge {u, v} with u < v once, sorted on u and then v: the edges of u are first[u] .. first[u + 1).
+    std::vector<uint64_t> first(N + 2, 0);
+    std::vector<uint32_t> from;
+    std::vector<uint32_t> to;
+    for(uint32_t u = 1; u <= N; ++u) {
+        first[u] = to.size();
+        forEachSetBit(graph.neighbours(u), u, N, [&](uint64_t i) {
+            from.push_back(u);
+            to.push_back(u + i + 1);
+        });
+    }
+    first[N + 1] = to.size();
+    auto edge = [&](uint32_t u, uint32_t v) {
+        if(u > v) std::swap(u, v);
+        return std::lower_bound(to.begin() + first[u], to.begin() + first[u + 1], v) - to.begin();
+    };
+
+    // Edges go on the stack once, when their support drops below the minimum.
+    std::vector<uint32_t> support(to.size());
+    std::vector<uint32_t> stack;
+    for(size_t e = 0; e < to.size(); ++e) {
+        support[e] = bitset_kernels::andCount(graph.neighbours(from[e]), graph.neighbours(to[e]), words);
+        if(support[e] < minSupport) {
+            stack.push_back(e);
+        }
+    }
+
+    // An edge is removed from the rows as soon as it comes off the stack, so the common neighbours of a later edge only
+    // give edges that are still there.
+    std::vector<uint64_t> common(words);
+    uint32_t removed = 0;
+    while(!stack.empty()) {
+        const uint32_t u = from[stack.back()];
+        const uint32_t v = to[stack.back()];
+        stack.pop_back();
+
+        bitset_kernels::andIntoCount(common.data(), graph.neighbours(u), graph.neighbours(v), words);
+        forEachSetBit(common.data(), 0, N, [&](uint64_t w) {
+            for(size_t e : { edge(u, w + 1), edge(v, w + 1) }) {
+                if(support[e]-- == minSupport) {
+                    stack.push_back(e);
+                }
+            }
+        });
+        graph.removeEdge(u, v);
+        ++removed;
+    }
+
+    graph.numberOfEdges -= removed;
+    return removed;
+}
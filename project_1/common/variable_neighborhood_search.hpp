@@ -0,0 +1,267 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include <bitset.hpp>
+#include <bitset_kernels.hpp>
+#include <incumbent.hpp>
+#include <anytime.hpp>
+
+/**
+ * Variable neighborhood search for the maximum clique, shared by the Variable neighborhood search solver and the
+ * portfolio mode of Branch and bound. Vertices are counted from 0 here, the graphs from 1.
+ */
+
+typedef uint32_t Vertex;
+// Bit v is vertex v, counted from 0 like everywhere in this file.
+typedef DynamicBitSet Clique;
+
+const int KMax = 15;
+
+// The graph as the search uses it, built once and shared read-only by all chains
+struct VnsGraph {
+    template<typename G>
+    VnsGraph(const G& graph) : neighbourRows(graph.numberOfVertices, DynamicBitSet(graph.numberOfVertices)), degrees(graph.numberOfVertices) {
+        const uint32_t N = graph.numberOfVertices;
+        for (Vertex v = 0; v < N; v++) {
+            for (Vertex u = 0; u < v; u++) {
+                if (graph.hasEdge(u + 1, v + 1)) {
+                    neighbourRows[v].insert(u);
+                    neighbourRows[u].insert(v);
+                }
+            }
+        }
+        for (Vertex v = 0; v < N; v++) {
+            degrees[v] = bitset_kernels::count(neighbourRows[v].data(), neighbourRows[v].wordCount());
+        }
+    }
+
+    uint32_t size() const {
+        return neighbourRows.size();
+    }
+
+    // The neighbours of every vertex as a set, whatever the storage of the graph
+    std::vector<DynamicBitSet> neighbourRows;
+    // The degree of every vertex in the graph
+    std::vector<uint32_t> degrees;
+};
+
+// A clique with the vertices that can be added to it, kept up to date while vertices are added and dropped.
+// The vertices of both are also kept in a list, so a random neighbor of the clique is drawn in O(1).
+struct CliqueState {
+    CliqueState(const VnsGraph& graph, const Clique& start) : graph(graph), clique(start), possibleAdds(graph.size()) {
+        for (Vertex v : clique) members.push_back(v);
+        recomputeAdds();
+    }
+
+    // add v, one of possibleAdds: only its neighbors can still be added
+    void add(Vertex v) {
+        clique.insert(v);
+        members.push_back(v);
+        bitset_kernels::andIntoCount(possibleAdds.data(), possibleAdds.data(), graph.neighbourRows[v].data(), possibleAdds.wordCount());
+        listAdds();
+    }
+
+    // drop v, one of members: the possible adds are the intersection of the rows of the remaining members again
+    void drop(Vertex v) {
+        clique.erase(v);
+        members.erase(std::find(members.begin(), members.end(), v));
+        recomputeAdds();
+    }
+
+    // number of cliques at distance 1: one per possible add, and one per member unless that would empty the clique
+    size_t neighborCount() const {
+        return adds.size() + (members.size() > 1 ? members.size() : 0);
+    }
+
+    // move to neighbor i, numbered like neighborCount
+    void moveToNeighbor(size_t i) {
+        if (i < adds.size()) add(adds[i]);
+        else drop(members[i - adds.size()]);
+    }
+
+    const VnsGraph& graph;
+    Clique clique;
+    DynamicBitSet possibleAdds;
+    std::vector<Vertex> members;
+    std::vector<Vertex> adds;
+
+private:
+    void recomputeAdds() {
+        if (members.empty()) {
+            possibleAdds.clear();
+            for (Vertex v = 0; v < graph.size(); v++) possibleAdds.insert(v);
+        } else {
+            std::copy(graph.neighbourRows[members[0]].data(), graph.neighbourRows[members[0]].data() + possibleAdds.wordCount(), possibleAdds.data());
+            for (size_t i = 1; i < members.size(); i++) {
+                bitset_kernels::andIntoCount(possibleAdds.data(), possibleAdds.data(), graph.neighbourRows[members[i]].data(), possibleAdds.wordCount());
+            }
+        }
+        // the rows leave out the vertex itself, so members only survive the AND when the clique is empty
+        listAdds();
+    }
+
+    void listAdds() {
+        adds.clear();
+        for (Vertex v : possibleAdds) adds.push_back(v);
+    }
+};
+
+// The best clique of all chains. Chains offer their best clique after every iteration and take over a bigger one.
+typedef Incumbent<Clique> SharedClique;
+
+// One chain of the variable neighborhood search, with all of its state and its own random numbers.
+// Chains on different threads only share the graph, the shared best clique and the budget.
+class VnsRun {
+public:
+    // Called with every clique that improves the shared best clique, by the thread of the chain
+    typedef std::function<void(const Clique&)> Publish;
+
+    VnsRun(const VnsGraph& graph, SharedClique& shared, Anytime& anytime, uint64_t seed, uint32_t chain, Publish publish = {})
+        : graph(graph), shared(shared), anytime(anytime), publish(std::move(publish)), biggestClique(graph.size()), currBiggestClique(graph.size()) {
+        std::seed_seq stream{(uint32_t) seed, (uint32_t) (seed >> 32), chain};
+        generator.seed(stream);
+    }
+
+    // Perform variable neighborhood search until maxItNoImprov iterations bring no bigger clique,
+    // the budget of anytime is used up or some chain reaches the target
+    void run(uint32_t target) {
+        // max iterations of vns we will do before we stop
+        const size_t maxItNoImprov = 50;
+
+        //set initial solution
+        Vertex randomStart = std::uniform_int_distribution<Vertex>(0, graph.size() - 1)(generator);
+        biggestClique.insert(randomStart);
+        currBiggestClique = biggestClique;
+        offer();
+
+        // while we have not had maxItNoImprov iterations without improvements do a vns step
+        while (iterationsSinceImprovement < maxItNoImprov && !anytime.expired() && !(target > 0 && shared.size() >= target)) {
+            vnsStep();
+            // If the biggestClique found is the biggest yet we store it in biggestClique
+            if (currBiggestClique.size() > biggestClique.size()) {
+                iterationsSinceImprovement = 0;
+                biggestClique = currBiggestClique;
+                offer();
+            }
+            // Restart from the best clique of all chains when another chain got further, that counts as an improvement
+            if (shared.size() > biggestClique.size()) {
+                shared.read([this](const Clique& best) { biggestClique = best; });
+                currBiggestClique = biggestClique;
+                iterationsSinceImprovement = 0;
+            }
+            iterationsSinceImprovement++;
+        }
+    }
+
+private:
+    void offer() {
+        if (shared.offer(biggestClique.size(), [this](Clique& best) { best = biggestClique; })) {
+            anytime.improve(biggestClique.size());
+            if (publish) publish(biggestClique);
+        }
+    }
+
+    void vnsStep() {
+        int k = 0;
+        // Try to search new optimum in neighborhood k
+        // neighborhood k has all cliques with distance k of currBiggestClique 
+        // (e.g. for k=2: 2 additions, or 2 deletions or 1 addition and 1 deltion)
+        while (k < KMax && !anytime.expired()) {
+            // choose random clique from neighborhood k
+            Clique nClique = shake(k, currBiggestClique);
+            // perform local search on nClique here with variable neighbourhood decent
+            Clique localBest = vnd(nClique);
+            // check if localBest is bigger than currBiggestClique
+            if (localBest.size() > currBiggestClique.size()) {
+                currBiggestClique = localBest;
+                // start searching again from neighborhood 0 with new localBest
+                k = 0;
+            } else {
+                k++;
+            }
+        }
+    }
+
+    // Do local search to get maximum clique that can be made from clique
+    // we do this by adding the best vertices one by one, the best vertex keeps the most possible adds open
+    Clique vnd(const Clique& clique) {
+        // get all vertices that can be added to the clique
+        CliqueState state(graph, clique);
+        const size_t words = state.possibleAdds.wordCount();
+
+        // The degree of every possible add within the possible adds, degrees in the graph break ties
+        std::vector<uint32_t> candidateDegree(graph.size());
+        for (Vertex v : state.adds) {
+            candidateDegree[v] = bitset_kernels::andCount(state.possibleAdds.data(), graph.neighbourRows[v].data(), words);
+        }
+        DynamicBitSet removed(graph.size());
+
+        // while we find nodes we can add to the clique, find the best one and add it to the clique
+        while (!state.adds.empty()) {
+            uint64_t bestDegree = 0;
+            Vertex bestVertex = state.adds[0];
+            // 80% Chance that we take the highest degree as best vertex 20% chance we take the lowest degree
+            bool isBest = std::uniform_int_distribution<int>(0, 99)(generator) > 20;
+            // get The degree from all poss and pick the highest/lowest as best vertex based ion isBest
+            for(Vertex v : state.adds) {
+                uint64_t currDegree = (uint64_t) candidateDegree[v] << 32 | graph.degrees[v];
+                if (v == state.adds[0] || (isBest && currDegree >= bestDegree) || (!isBest && currDegree <= bestDegree)) {
+                    bestDegree = currDegree;
+                    bestVertex = v;
+                }
+            }
+            // add the best vertex to the clique, only its neighbors stay possible adds
+            std::copy(state.possibleAdds.data(), state.possibleAdds.data() + words, removed.data());
+            state.add(bestVertex);
+            bitset_kernels::andNotInto(removed.data(), removed.data(), state.possibleAdds.data(), words);
+
+            // The remaining possible adds lose the removed ones as neighbors, from whichever side is smaller
+            if (bitset_kernels::count(removed.data(), words) < state.adds.size()) {
+                for (Vertex r : removed) {
+                    const uint64_t* row = graph.neighbourRows[r].data();
+                    for (size_t word = 0; word < words; word++) {
+                        for (uint64_t common = state.possibleAdds.data()[word] & row[word]; common != 0; common &= common - 1) {
+                            candidateDegree[(word << 6) + std::countr_zero(common)]--;
+                        }
+                    }
+                }
+            } else {
+                for (Vertex v : state.adds) {
+                    candidateDegree[v] = bitset_kernels::andCount(state.possibleAdds.data(), graph.neighbourRows[v].data(), words);
+                }
+            }
+        }
+
+        return state.clique;
+    }
+
+    // get a random clique from neighborhood k
+    Clique shake(int k, const Clique& clique) {
+        // Take a random clique from neighborhood 1 of the current clique, which is generated from its possible adds and its members
+        // Do this k times so we will have a clique on distance k from the original clique 
+        CliqueState state(graph, clique);
+        for (int i=0; i<k; i++){
+            // a lone vertex without neighbors has no neighborhood
+            if (state.neighborCount() == 0) break;
+            // get a random neighbor
+            state.moveToNeighbor(std::uniform_int_distribution<size_t>(0, state.neighborCount() - 1)(generator));
+        }
+        return state.clique;
+    }
+
+    const VnsGraph& graph;
+    SharedClique& shared;
+    Anytime& anytime;
+    Publish publish;
+    std::mt19937 generator;
+    Clique biggestClique;
+    Clique currBiggestClique;
+    size_t iterationsSinceImprovement = 0;
+};
+
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include <flags.hpp>
+
+/**
+ * Runs tasks on a fixed number of workers, each with its own deque.
+ *
+ * A worker pushes the tasks it creates at the back of its own deque and takes its next task from the back as well,
+ * so it goes depth first through its own subtree. A worker without tasks steals from the front of another worker's
+ * deque, where the oldest tasks are: those closest to the root, so the largest subtrees.
+ *
+ * The deques are a mutex with a std::deque each. A task in a branch and bound is a whole subtree, so the locking
+ * is noise next to the work in a task.
+ */
+template<typename Task>
+class WorkStealingPool final {
+public:
+    explicit WorkStealingPool(uint32_t workers) : workers(workers), queues(new Queue[workers]), pending(0) {}
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+
+    uint32_t size() const {
+        return workers;
+    }
+
+    /**
+     * @brief   Adds a task to the deque of a worker. Can be called before run() and by the workers while running.
+     * @param worker    The worker that owns the deque
+     * @param task      The task
+     */
+    void push(uint32_t worker, Task task) {
+        pending.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(queues[worker].mutex);
+        queues[worker].tasks.push_back(std::move(task));
+    }
+
+    /**
+     * @brief   Runs until every task, including the ones pushed while running, has been processed.
+     *          The calling thread is worker 0, the other workers get their own thread.
+     * @param process   Called as process(worker, task), may push new tasks
+     */
+    template<typename F>
+    void run(F process) {
+        std::vector<std::thread> threads;
+        for(uint32_t worker = 1; worker < workers; ++worker) {
+            threads.emplace_back([this, worker, &process] { work(worker, process); });
+        }
+        work(0, process);
+        for(std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+private:
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    template<typename F>
+    void work(uint32_t worker, F& process) {
+        Task task;
+        while(true) {
+            if(pop(worker, task) || steal(worker, task)) {
+                process(worker, task);
+                // Tasks pushed by process were counted before this one is taken off.
+                pending.fetch_sub(1, std::memory_order_acq_rel);
+            } else if(pending.load(std::memory_order_acquire) == 0) {
+                return;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    bool pop(uint32_t worker, Task& task) {
+        std::lock_guard<std::mutex> lock(queues[worker].mutex);
+        if(queues[worker].tasks.empty()) {
+            return false;
+        }
+        task = std::move(queues[worker].tasks.back());
+        queues[worker].tasks.pop_back();
+        return true;
+    }
+
+    bool steal(uint32_t worker, Task& task) {
+        for(uint32_t i = 1; i < workers; ++i) {
+            Queue& victim = queues[(worker + i) % workers];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if(!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint32_t workers;
+    std::unique_ptr<Queue[]> queues;
+    std::atomic<uint64_t> pending;
+};
+
+// Largest thread count "--threads=<n>" accepts, every worker gets its own deque and search state.
+static constexpr uint32_t maxThreads = 1024;
+
+/**
+ * @brief   Reads a "--threads=<n>" command line argument, 0 means one thread per hardware thread.
+ * @param argument  The argument
+ * @param threads   Set to the number of threads
+ * @retval  Whether the argument was the threads flag.
+ * @throws  std::invalid_argument when the number is malformed or above maxThreads
+ */
+inline bool parseThreadsFlag(const char* argument, uint32_t& threads) {
+    uint32_t value;
+    if(!parseNumberFlag(argument, "--threads=", value)) {
+        return false;
+    }
+    if(value > maxThreads) {
+        throw std::invalid_argument(std::string("At most ") + std::to_string(maxThreads) + " threads in " + argument);
+    }
+    threads = value == 0 ? std::max(1U, std::thread::hardware_concurrency()) : value;
+    return true;
+}
@@ -3,15 +3,28 @@
 
 #include <graph.hpp>
 #include <clq_weighted_parser.hpp>
+#include <graph_snapshot.hpp>
 #include <mtx_parser.hpp>
 #include <unordered_set>
 #include <set>
 #include <map>
 #include <queue>
 #include <bitset.hpp>
+#include <search_stats.hpp>
 
 //#define MTX
 
+// Defined by "make bench".
+#ifdef DO_BENCHMARK
+#include <benchmark_suite.hpp>
+#endif
+
+// Bounds the search prunes on, in the order of their names in the statistics.
+enum Bound : uint32_t {
+    // The clique cover lower bound of the remaining vertices cannot beat the best cover
+    CliqueCover,
+};
+
 bool degree0(Graph2D &graph, DynamicBitSet &activeVertices) {
     // Nodes with a degree of 0 are always nodes separated from the other nodes
     // Removing such nodes will not have an influence on other nodes, thus looping
@@ -232,7 +245,8 @@ uint32_t lowerBound(Graph2D &graph, DynamicBitSet activeVertices, std::map<uint3
     return result;
 }
 
-DynamicBitSet search(Graph2D &graph, DynamicBitSet &activeVertices, std::map<uint32_t, DynamicBitSet> &neighbours, DynamicBitSet &vertexCover, uint32_t vertexCoverWeight, DynamicBitSet &vertexCoverBest) {
+DynamicBitSet search(Graph2D &graph, DynamicBitSet &activeVertices, std::map<uint32_t, DynamicBitSet> &neighbours, DynamicBitSet &vertexCover, uint32_t vertexCoverWeight, DynamicBitSet &vertexCoverBest, uint32_t depth, SearchStats &stats) {
+    stats.node(depth);
     uint32_t vertexCoverBestWeight = 0;
     for(uint32_t vector : vertexCoverBest) {
         vertexCoverBestWeight += graph.getWeight(vector);
@@ -240,6 +254,7 @@ DynamicBitSet search(Graph2D &graph, DynamicBitSet &activeVertices, std::map<uin
     
     if(activeVertices.empty()) {
         if (vertexCoverBestWeight > vertexCoverWeight) {
+            stats.incumbent(vertexCoverWeight);
             return vertexCover;
         } else {
             return vertexCoverBest;
@@ -247,6 +262,7 @@ DynamicBitSet search(Graph2D &graph, DynamicBitSet &activeVertices, std::map<uin
     }
 
     if(lowerBound(graph, activeVertices, neighbours) + vertexCoverWeight >= vertexCoverBestWeight) {
+        stats.prune(Bound::CliqueCover);
         return vertexCoverBest;
     }
 
@@ -256,7 +272,7 @@ DynamicBitSet search(Graph2D &graph, DynamicBitSet &activeVertices, std::map<uin
 
     activeVertices.erase(v);
     vertexCover.insert(v);
-    vertexCoverBest = search(graph, activeVertices, neighbours, vertexCover, vertexCoverWeight + graph.getWeight(v), vertexCoverBest);
+    vertexCoverBest = search(graph, activeVertices, neighbours, vertexCover, vertexCoverWeight + graph.getWeight(v), vertexCoverBest, depth + 1, stats);
     vertexCover.erase(v);
 
     DynamicBitSet tmpNeighbours {graph.numberOfVertices};
@@ -269,7 +285,7 @@ DynamicBitSet search(Graph2D &graph, DynamicBitSet &activeVertices, std::map<uin
         }
     }
 
-    auto result = search(graph, activeVertices, neighbours, vertexCover, vertexCoverWeight, vertexCoverBest);
+    auto result = search(graph, activeVertices, neighbours, vertexCover, vertexCoverWeight, vertexCoverBest, depth + 1, stats);
 
     activeVertices.insert(v);
     for(uint32_t neighbour : tmpNeighbours) {
@@ -282,7 +298,8 @@ DynamicBitSet search(Graph2D &graph, DynamicBitSet &activeVertices, std::map<uin
 }
 
 // branch and bound minimum weight vertex cover algo
-DynamicBitSet bmwvc(Graph2D &graph) {
+// Every connected component is searched on its own, the incumbents in the statistics are per component.
+DynamicBitSet bmwvc(Graph2D &graph, SearchStats &stats) {
     // Current active vertices in the graph
     DynamicBitSet activeVertices {graph.numberOfVertices};
     for(uint32_t i = 0; i < graph.numberOfVertices; ++i) {
@@ -321,15 +338,47 @@ DynamicBitSet bmwvc(Graph2D &graph) {
         
         DynamicBitSet tmpVertexCover {graph.numberOfVertices};
         DynamicBitSet tmpVertexCoverBest {subGraph};
-        vertexCover.insertAll(search(graph, subGraph, neighbours, tmpVertexCover, 0, tmpVertexCoverBest));
+        vertexCover.insertAll(search(graph, subGraph, neighbours, tmpVertexCover, 0, tmpVertexCoverBest, 0, stats));
     }
+    stats.proof();
 
     return vertexCover;
 }
 
+#ifdef DO_BENCHMARK
+
+int main(int argc, char* argv[]) {
+    return benchmark_suite::run(argc, argv, { "../TestData" }, [] {
+        // Without a given corpus only the dense graphs up to 200 vertices: a sparse graph leaves a large cover to
+        // search, c-fat200-1 or R160_320 already take far longer than a benchmark run.
+        benchmark_suite::registerSolver<Graph2D, ClqWeightedParser>("MWVCBranchAndBound", [](unsigned seed) { srand(seed); }, [](Graph2D& graph) {
+            SearchStats stats("MWVCBranchAndBound", { "cliqueCover" });
+            benchmark::DoNotOptimize(bmwvc(graph, stats));
+        }, { .maxVertices = 200, .minDensity = 0.4 });
+    });
+}
+
+#else
+
 int main(int argc, char* argv[]) {
-    if(argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " [filename]" << std::endl;
+    const char* fileName = nullptr;
+    std::string statsFileName;
+    try {
+        for(int i = 1; i < argc; ++i) {
+            if(parseStatsFlag(argv[i], statsFileName)) {
+                continue;
+            }
+            if(fileName != nullptr) {
+                throw std::invalid_argument("Too many arguments");
+            }
+            fileName = argv[i];
+        }
+    } catch(std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        fileName = nullptr;
+    }
+    if(fileName == nullptr) {
+        std::cerr << "Usage: " << argv[0] << " [--stats=<json file>] [filename]" << std::endl;
         return 1;
     }
 
@@ -338,7 +387,7 @@ int main(int argc, char* argv[]) {
 #ifdef MTX  
     try {
         MtxParser parser;
-        parser.parse(*argv[1], graph);
+        parser.parse(*fileName, graph);
     } catch(std::exception& e) {
         std::cerr << "Parsing failure: " << e.what() << std::endl;
         return 2;
@@ -351,8 +400,8 @@ int main(int argc, char* argv[]) {
     }
 #else
     try {
-        ClqWeightedParser parser;
-        parser.parse(*argv[1], graph);
+        GraphCache<ClqWeightedParser> cache;
+        cache.load(*fileName, graph);
     } catch(std::exception& e) {
         std::cerr << "Parsing failure: " << e.what() << std::endl;
         return 2;
@@ -362,7 +411,8 @@ int main(int argc, char* argv[]) {
 #endif
 
     std::cout << "Graph of " << N << " vertices, " << graph.numberOfEdges << " edges, density " << graph.density() << std::endl;
-    DynamicBitSet result = bmwvc(graph);
+    SearchStats stats("MWVCBranchAndBound", { "cliqueCover" });
+    DynamicBitSet result = bmwvc(graph, stats);
 
     std::cout << "Minimum weighted vertex cover: [ ";
     uint32_t weight = 0;
@@ -372,6 +422,17 @@ int main(int argc, char* argv[]) {
     }
     std::cout << "]";
     std::cout << ", total weight: " << weight << std::endl;
-    
+
+    if(!statsFileName.empty()) {
+        try {
+            stats.writeJson(statsFileName);
+        } catch(std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 3;
+        }
+    }
+
     return 0;
 }
+
+#endif
@@ -9,11 +9,22 @@
 #include <matrix.hpp>
 #include <graph.hpp>
 #include <clq_weighted_parser.hpp>
+#include <graph_snapshot.hpp>
 #include <bitset.hpp>
+#include <bitset_kernels.hpp>
+#include <bitset_arena.hpp>
+
+// Defined by "make bench".
+#ifdef DO_BENCHMARK
+#include <benchmark_suite.hpp>
+#endif
 
 std::random_device device;
 std::mt19937 generator(device());
 
+// Scratch sets of localSearch, evaluating a move never touches the heap.
+BitSetArena scratch;
+
 typedef Graph2D GraphType;
 typedef uint32_t Count;
 typedef uint32_t Vertex;
@@ -21,26 +32,20 @@ typedef uint32_t Vertex;
 void calculateUnSetRaw(const GraphType& graph, DynamicBitSet& Un, Vertex v) {
     // Note: can't calculate score here because we might count some elements double depending on what is in Un already.
     // Un(v, S) = if v is in S, => set of vertices of all neighbours of v not in S
-    auto neighbours = graph.neighbours(v);
-    for(uint32_t i = 0, length = graph.amountOfBitVectors(); i < length; ++i) {
-        Un.insertBitVector(i, neighbours[i]);
-        //std::cout << "N[" << i<<"] = " << neighbours[i] << std::endl;
-    }
+    bitset_kernels::orInto(Un.data(), Un.data(), graph.neighbours(v), graph.amountOfBitVectors());
 }
 
-std::pair<DynamicBitSet, float> calculateUnSet(const GraphType& graph, const DynamicBitSet& S, Vertex v) {
-    DynamicBitSet Un { graph.numberOfVertices };
-    calculateUnSetRaw(graph, Un, v);
-    Un.eraseAll(S);
+float calculateUnSet(const GraphType& graph, const DynamicBitSet& S, Vertex v, DynamicBitSet& Un) {
+    bitset_kernels::andNotInto(Un.data(), graph.neighbours(v), S.data(), graph.amountOfBitVectors());
     float evSwap = graph.getWeight(v);
     for(auto u : Un) {
         evSwap -= graph.getWeight(u);
     }
-    return std::make_pair(Un, evSwap);
+    return evSwap;
 }
 
-std::pair<DynamicBitSet, float> calculateUnSet(const GraphType& graph, const DynamicBitSet& S, Vertex u, Vertex v) {
-    DynamicBitSet Un { graph.numberOfVertices };
+float calculateUnSet(const GraphType& graph, const DynamicBitSet& S, Vertex u, Vertex v, DynamicBitSet& Un) {
+    Un.clear();
     calculateUnSetRaw(graph, Un, u);
     calculateUnSetRaw(graph, Un, v);
     Un.eraseAll(S);
@@ -48,18 +53,11 @@ std::pair<DynamicBitSet, float> calculateUnSet(const GraphType& graph, const Dyn
     for(auto u : Un) {
         evSwap -= graph.getWeight(u);
     }
-    return std::make_pair(Un, evSwap);
+    return evSwap;
 }
 
 bool hasCommonNeighbours(const GraphType& graph, Vertex u, Vertex v) {
-    auto neighbours1 = graph.neighbours(u);
-    auto neighbours2 = graph.neighbours(v);
-    for(uint32_t i = 0, l = graph.amountOfBitVectors(); i < l; ++i) {
-        if(neighbours1[i] & neighbours2[i]) {
-            return true;
-        }
-    }
-    return false;
+    return bitset_kernels::andAny(graph.neighbours(u), graph.neighbours(v), graph.amountOfBitVectors());
 }
 
 void localSearch(const GraphType& graph, DynamicBitSet& S) {
@@ -74,7 +72,9 @@ void localSearch(const GraphType& graph, DynamicBitSet& S) {
 
             // Calculate impItems
             for(auto v : S) {
-                auto [Un, evSwap] = calculateUnSet(graph, S, v);
+                BitSetArena::Scope scope(scratch);
+                DynamicBitSet Un { graph.numberOfVertices, scratch };
+                float evSwap = calculateUnSet(graph, S, v, Un);
 
                 if(evSwap > 0.0f) {
                     //std::cout << "evSwap imp: " << evSwap << std::endl;
@@ -101,7 +101,9 @@ void localSearch(const GraphType& graph, DynamicBitSet& S) {
         for(auto u : S) {
             for(auto v : S) {
                 if(u != v && !graph.hasEdge(u, v) && hasCommonNeighbours(graph, u, v)) {
-                    auto [Un, evSwap] = calculateUnSet(graph, S, u, v);
+                    BitSetArena::Scope scope(scratch);
+                    DynamicBitSet Un { graph.numberOfVertices, scratch };
+                    float evSwap = calculateUnSet(graph, S, u, v, Un);
                     //std::cout << "{u,v}=" << u <<","<<v<<std::endl;
                     //std::cout << "Un: ";
                     //for(auto x : Un) {
@@ -324,6 +326,19 @@ DynamicBitSet fss(GraphType& graph) {
     return bestSolution;
 }
 
+#ifdef DO_BENCHMARK
+
+int main(int argc, char* argv[]) {
+    return benchmark_suite::run(argc, argv, { "../TestData" }, [] {
+        // Without a given corpus the graphs above 250 vertices are left out, from there on a solve takes tens of seconds.
+        benchmark_suite::registerSolver<GraphType, ClqWeightedParser>("FixedSetSearch", [](unsigned seed) { generator.seed(seed); }, [](GraphType& graph) {
+            benchmark::DoNotOptimize(fss(graph));
+        }, { .maxVertices = 250 });
+    });
+}
+
+#else
+
 int main(int argc, char* argv[]) {
     if(argc != 2) {
         std::cerr << "Usage: " << argv[0] << " [filename]" << std::endl;
@@ -332,8 +347,8 @@ int main(int argc, char* argv[]) {
 
     GraphType graph;
     try {
-        ClqWeightedParser parser;
-        parser.parse(*argv[1], graph);
+        GraphCache<ClqWeightedParser> cache;
+        cache.load(*argv[1], graph);
     } catch(std::exception& e) {
         std::cerr << "Parsing failure: " << e.what() << std::endl;
         return 2;
@@ -351,3 +366,5 @@ int main(int argc, char* argv[]) {
 
     return 0;
 }
+
+#endif
@@ -10,6 +10,11 @@
 #include <functional>
 #include <cstring>
 
+// Defined by "make bench".
+#ifdef DO_BENCHMARK
+#include <benchmark_suite.hpp>
+#endif
+
 using namespace std;
 
 typedef uint32_t Vertex;
@@ -102,6 +107,24 @@ pair<VertexCover, uint32_t> pricing_method(EdgeSetGraph &g, map<Vertex, uint32_t
     return make_pair(vertexCover, total_weight);
 }
 
+#ifdef DO_BENCHMARK
+
+int main(int argc, char *argv[])
+{
+    return benchmark_suite::run(argc, argv, {"../TestData"}, [] {
+        benchmark_suite::registerSolver<EdgeSetGraph, ClqWeightedParser>("Pricing", [](unsigned seed) { srand(seed); }, [](EdgeSetGraph &graph) {
+            map<Vertex, uint32_t> weights;
+            for (Vertex v = 1; v <= graph.numberOfVertices; v++)
+            {
+                weights[v] = graph.getWeight(v);
+            }
+            benchmark::DoNotOptimize(pricing_method(graph, weights, get_first_node_weight));
+        });
+    });
+}
+
+#else
+
 int main(int argc, char *argv[])
 {
     srand(time(NULL));
@@ -168,4 +191,6 @@ int main(int argc, char *argv[])
     }
     cout << endl;
     return 0;
-}
\ No newline at end of file
+}
+
+#endif
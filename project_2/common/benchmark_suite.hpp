@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <utility>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <unordered_set>
+
+#include <benchmark/benchmark.h>
+
+#include <mapped_file.hpp>
+#include <clq_decoder.hpp>
+
+/**
+ * Google Benchmark suite shared by the "make bench" targets of the solvers.
+ *
+ * For every solver and every .clq file in the corpus two benchmarks are registered:
+ *   <solver>/parse/<dir>/<file>   parsing the text file into the graph (no snapshot)
+ *   <solver>/solve/<dir>/<file>   only the search, on a freshly parsed graph, reseeded with the same seed every run
+ *
+ * The corpus is every .clq file under the default directories (the TestData sets) and under --corpus=<dir>
+ * or $BENCH_CORPUS. Of the default directories a solver only gets the graphs its Selection lets through, so a plain
+ * "./bench" finishes; the files of a given corpus are always benchmarked. Solves run once per repetition
+ * ($BENCH_REPETITIONS, 3 by default), the JSON report is written to bench.json unless --benchmark_out says otherwise.
+ */
+namespace benchmark_suite {
+
+static constexpr unsigned seed = 42;
+
+/**
+ * Which graphs of the default directories a solver is benchmarked on.
+ */
+struct Selection {
+    // The weight sets (DimacsAdapted_1_20 and _1_500, ...) hold the same graphs with other weights. A solver that
+    // ignores the weights gets every file name once.
+    bool weighted = true;
+    // Larger graphs are left out
+    uint32_t maxVertices = std::numeric_limits<uint32_t>::max();
+    // Graphs with a density outside of these are left out
+    double minDensity = 0.0;
+    double maxDensity = 1.0;
+};
+
+struct Instance {
+    std::string file;
+    // Under --corpus=<dir> or $BENCH_CORPUS, so never left out by a Selection
+    bool given;
+};
+
+inline std::vector<Instance>& corpus() {
+    static std::vector<Instance> files;
+    return files;
+}
+
+inline int repetitions() {
+    const char* value = std::getenv("BENCH_REPETITIONS");
+    return value != nullptr && atoi(value) > 0 ? atoi(value) : 3;
+}
+
+/**
+ * @brief   Whether a file of the default directories fits the selection of a solver, judged on its parameter line.
+ */
+inline bool selected(const std::string& file, const Selection& selection) {
+    MappedFile mapped(file.c_str());
+    auto header = ClqDecoder(true).decodeHeader(mapped.begin(), mapped.end());
+    const double vertices = header.numberOfVertices;
+    const double density = vertices > 1 ? 2.0 * header.numberOfEdges / (vertices * (vertices - 1)) : 0.0;
+    return header.numberOfVertices <= selection.maxVertices && density >= selection.minDensity && density <= selection.maxDensity;
+}
+
+/**
+ * @brief   Registers the parse and solve benchmarks of one solver for every file in the corpus it selects.
+ * @param solver    Name of the solver in the benchmark names
+ * @param reseed    Called with the fixed seed before every solve, resets the solver's random state
+ * @param solve     Runs the search on a parsed graph
+ * @param selection Which graphs of the default directories the solver gets
+ */
+template<typename G, typename Parser>
+void registerSolver(const std::string& solver, std::function<void(unsigned)> reseed, std::function<void(G&)> solve, const Selection& selection = {}) {
+    std::unordered_set<std::string> names;
+    for(const auto& [file, given] : corpus()) {
+        std::filesystem::path path(file);
+        if(!given && !selected(file, selection)) {
+            continue;
+        }
+        if(!selection.weighted && !names.insert(path.filename().string()).second) {
+            continue;
+        }
+        std::string name = path.parent_path().filename().string() + "/" + path.filename().string();
+
+        benchmark::RegisterBenchmark((solver + "/parse/" + name).c_str(), [file](benchmark::State& state) {
+            for(auto _ : state) {
+                G graph;
+                Parser().parse(*file.c_str(), graph);
+                benchmark::DoNotOptimize(graph.numberOfEdges);
+            }
+        })->Unit(benchmark::kMillisecond);
+
+        benchmark::RegisterBenchmark((solver + "/solve/" + name).c_str(), [file, reseed, solve](benchmark::State& state) {
+            for(auto _ : state) {
+                state.PauseTiming();
+                // Solvers reorder or shrink the graph, so every run gets its own.
+                auto graph = std::make_unique<G>();
+                Parser().parse(*file.c_str(), *graph);
+                reseed(seed);
+                // The solvers report progress on stdout, that is muted while timing.
+                auto* output = std::cout.rdbuf(nullptr);
+                state.ResumeTiming();
+
+                solve(*graph);
+
+                state.PauseTiming();
+                std::cout.rdbuf(output);
+                std::cout.clear();
+                graph.reset();
+                state.ResumeTiming();
+            }
+        })->Unit(benchmark::kMillisecond)->Iterations(1)->Repetitions(repetitions());
+    }
+}
+
+/**
+ * @brief   Collects the corpus, lets the solver register its benchmarks and runs them.
+ * @param defaultDirectories    Directories that are always part of the corpus
+ * @param registerSolvers       Registers the benchmarks, called once the corpus is known
+ * @retval  Exit code
+ */
+inline int run(int argc, char** argv, const std::vector<std::string>& defaultDirectories, const std::function<void()>& registerSolvers) {
+    // The default directories come first, a given directory is marked as such.
+    std::vector<std::pair<std::string, bool>> directories;
+    for(const std::string& directory : defaultDirectories) {
+        directories.emplace_back(directory, false);
+    }
+    if(const char* directory = std::getenv("BENCH_CORPUS")) {
+        directories.emplace_back(directory, true);
+    }
+
+    // Take out our own flag and add the JSON report unless one was asked for, the rest goes to Google Benchmark.
+    std::vector<char*> arguments;
+    bool hasOutput = false;
+    static char defaultOutput[] = "--benchmark_out=bench.json";
+    for(int i = 0; i < argc; ++i) {
+        if(strncmp(argv[i], "--corpus=", 9) == 0) {
+            directories.emplace_back(argv[i] + 9, true);
+            continue;
+        }
+        hasOutput = hasOutput || strncmp(argv[i], "--benchmark_out=", 16) == 0;
+        arguments.push_back(argv[i]);
+    }
+    if(!hasOutput) {
+        arguments.push_back(defaultOutput);
+    }
+
+    for(const auto& [directory, given] : directories) {
+        std::error_code error;
+        for(auto it = std::filesystem::recursive_directory_iterator(directory, error); !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+            if(it->is_regular_file() && it->path().extension() == ".clq") {
+                corpus().push_back({ std::filesystem::weakly_canonical(it->path()).string(), given });
+            }
+        }
+        if(error) {
+            std::cerr << "Skipping corpus directory " << directory << ": " << error.message() << std::endl;
+        }
+    }
+    // A file under both a default and a given directory is kept once, as given.
+    std::sort(corpus().begin(), corpus().end(), [](const Instance& a, const Instance& b) {
+        return a.file != b.file ? a.file < b.file : a.given > b.given;
+    });
+    corpus().erase(std::unique(corpus().begin(), corpus().end(), [](const Instance& a, const Instance& b) { return a.file == b.file; }), corpus().end());
+
+    registerSolvers();
+
+    int count = arguments.size();
+    benchmark::Initialize(&count, arguments.data());
+    if(benchmark::ReportUnrecognizedArguments(count, arguments.data())) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
+
+}
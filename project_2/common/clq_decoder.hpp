@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <thread>
+#include <exception>
+#include <algorithm>
+
+/**
+ * Decodes the text of a DIMACS .clq file without going through iostreams.
+ *
+ * The header (comments and the 'p' line) is read sequentially. The body is split into newline-aligned
+ * chunks that are decoded on separate threads into a buffer per chunk. The parsers then feed those
+ * buffers to the graph in file order, so the graph sees exactly the same calls as before.
+ */
+class ClqDecoder final {
+public:
+    struct Edge {
+        uint32_t from;
+        uint32_t to;
+    };
+
+    struct Weight {
+        uint32_t vertex;
+        uint32_t weight;
+    };
+
+    struct Chunk {
+        std::vector<Edge> edges;
+        std::vector<Weight> weights;
+    };
+
+    struct Header {
+        uint32_t numberOfVertices { 0 };
+        uint32_t numberOfEdges { 0 };
+        // Start of the first line after the parameter line.
+        const char* body { nullptr };
+    };
+
+    // Chunks smaller than this are not worth a thread.
+    static constexpr size_t minimumChunkSize = 256 * 1024;
+
+    ClqDecoder(bool acceptWeights) : acceptWeights(acceptWeights) {}
+    ClqDecoder(const ClqDecoder&) = delete;
+    ~ClqDecoder() {}
+
+    /**
+     * @brief   Reads the comments and the parameter line at the start of the file.
+     */
+    Header decodeHeader(const char* begin, const char* end) const {
+        Header header;
+        const char* p = begin;
+        while(p < end) {
+            const char* line = skipBlanks(p, end);
+            const char* next = nextLine(line, end);
+
+            if(line == next || *line == '\n' || *line == 'c') {
+                p = next;
+                continue;
+            }
+
+            if(*line != 'p') {
+                throw std::runtime_error("Missing parameter line");
+            }
+
+            // Skip the 'p' token and the format token ("edge", "col", ...).
+            const char* q = skipToken(skipToken(line, next), next);
+            q = parseUnsigned(q, next, header.numberOfVertices);
+            parseUnsigned(q, next, header.numberOfEdges);
+            header.body = next;
+            return header;
+        }
+
+        throw std::runtime_error("Missing parameter line");
+    }
+
+    /**
+     * @brief   Decodes all edge (and weight) lines in [begin, end) in parallel.
+     * @retval  The decoded chunks, in file order.
+     */
+    std::vector<Chunk> decodeBody(const char* begin, const char* end) const {
+        size_t length = end - begin;
+        size_t threads = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), length / minimumChunkSize));
+
+        // Cut the body at newlines so no line is split between two chunks.
+        std::vector<const char*> bounds { begin };
+        for(size_t i = 1; i < threads; ++i) {
+            const char* cut = std::max(bounds.back(), begin + length * i / threads);
+            bounds.push_back(nextLine(cut, end));
+        }
+        bounds.push_back(end);
+
+        std::vector<Chunk> chunks(threads);
+        std::vector<std::exception_ptr> errors(threads);
+        auto work = [&](size_t i) {
+            try {
+                decodeChunk(bounds[i], bounds[i + 1], chunks[i]);
+            } catch(...) {
+                errors[i] = std::current_exception();
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for(size_t i = 1; i < threads; ++i) {
+            workers.emplace_back(work, i);
+        }
+        work(0);
+        for(auto& worker : workers) {
+            worker.join();
+        }
+
+        for(auto& error : errors) {
+            if(error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+        return chunks;
+    }
+
+private:
+    bool acceptWeights;
+
+    static const char* skipBlanks(const char* p, const char* end) {
+        while(p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+        return p;
+    }
+
+    static const char* skipToken(const char* p, const char* end) {
+        p = skipBlanks(p, end);
+        while(p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') ++p;
+        return p;
+    }
+
+    // Returns the start of the line after the one p is in.
+    static const char* nextLine(const char* p, const char* end) {
+        while(p < end && *p != '\n') ++p;
+        return p < end ? p + 1 : end;
+    }
+
+    static const char* parseUnsigned(const char* p, const char* end, uint32_t& value) {
+        p = skipBlanks(p, end);
+        if(p == end || *p < '0' || *p > '9') {
+            throw std::runtime_error("Expected a number");
+        }
+
+        uint32_t result = 0;
+        while(p < end && *p >= '0' && *p <= '9') {
+            result = result * 10 + (*p - '0');
+            ++p;
+        }
+        value = result;
+        return p;
+    }
+
+    void decodeChunk(const char* p, const char* end, Chunk& chunk) const {
+        // Edge lines are at least 6 bytes ("e 1 2\n"), so this over-reserves a bit but never grows.
+        chunk.edges.reserve((end - p) / 6);
+
+        while(p < end) {
+            const char* line = skipBlanks(p, end);
+            const char* next = nextLine(line, end);
+
+            if(line == next || *line == '\n') {
+                p = next;
+                continue;
+            }
+
+            switch(*line) {
+                // Comment
+                case 'c':
+                    break;
+
+                // Edges
+                case 'e': {
+                    Edge edge;
+                    const char* q = parseUnsigned(line + 1, next, edge.from);
+                    parseUnsigned(q, next, edge.to);
+                    chunk.edges.push_back(edge);
+                    break;
+                }
+
+                // Weights
+                case 'w': {
+                    if(!acceptWeights) {
+                        throw std::runtime_error(std::string("Unexpected token ") + *line);
+                    }
+                    Weight weight;
+                    const char* q = parseUnsigned(line + 1, next, weight.vertex);
+                    parseUnsigned(q, next, weight.weight);
+                    chunk.weights.push_back(weight);
+                    break;
+                }
+
+                default: {
+                    throw std::runtime_error(std::string("Unexpected token ") + *line);
+                }
+            }
+
+            p = next;
+        }
+    }
+};
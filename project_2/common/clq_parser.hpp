@@ -2,8 +2,9 @@
 
 #include <cstdint>
 #include <iostream>
-#include <fstream>
-#include <limits>
+
+#include <mapped_file.hpp>
+#include <clq_decoder.hpp>
 
 #ifdef GRAPH_STARTS_AT_ZERO
 #define GRAPH_CORRECTION 1
@@ -36,41 +37,16 @@ public:
 
     template<typename G>
     void parse(const char& fileName, G& graph) const {
-        std::ifstream inputFile(&fileName);
-        if(!inputFile) {
-            throw std::runtime_error("Could not open source file");
-        }
-
-        std::string part;
-        while(inputFile >> part) {
-            switch(part[0]) {
-                // Comment
-                case 'c':
-                    inputFile.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-                    continue;
-                
-                // Parameters
-                case 'p': {
-                    uint32_t numberOfVertices, numberOfEdges;
-                    inputFile >> part;
-                    inputFile >> numberOfVertices;
-                    inputFile >> numberOfEdges;
-                    graph.setParameters(numberOfVertices, numberOfEdges);
-                    break;
-                }
+        MappedFile file(&fileName);
+        ClqDecoder decoder(false);
 
-                // Edges
-                case 'e': {
-                    uint32_t from, to;
-                    inputFile >> from;
-                    inputFile >> to;
-                    graph.addEdge(from - GRAPH_CORRECTION, to - GRAPH_CORRECTION);
-                    break;
-                }
+        auto header = decoder.decodeHeader(file.begin(), file.end());
+        graph.setParameters(header.numberOfVertices, header.numberOfEdges);
 
-                default: {
-                    throw std::runtime_error(std::string("Unexpected token ") + part[0]);
-                }
+        // Decoding happens in parallel, building the adjacency in one pass afterwards.
+        for(auto& chunk : decoder.decodeBody(header.body, file.end())) {
+            for(auto edge : chunk.edges) {
+                graph.addEdge(edge.from - GRAPH_CORRECTION, edge.to - GRAPH_CORRECTION);
             }
         }
     }
@@ -9,6 +9,7 @@
 #include <graph.hpp>
 #include <offset_array.hpp>
 #include <bitset.hpp>
+#include <mapped_file.hpp>
 
 void Graph::addEdge(uint32_t from, uint32_t to) {
     auto offset = ref(from - GRAPH_OFFSET, to - GRAPH_OFFSET);
@@ -163,6 +164,26 @@ void Graph2D::removeEdge(uint32_t from, uint32_t to) {
     --degrees[to - GRAPH_OFFSET];
 }
 
+void Graph2D::adoptStorage(uint32_t numberOfVertices, uint32_t numberOfEdges, uint64_t** rows, std::shared_ptr<MappedFile> snapshot) {
+    Graph::setParameters(numberOfVertices, numberOfEdges);
+    this->snapshot = std::move(snapshot);
+    storage = rows;
+
+    // Degrees aren't stored, counting them is a pass over the rows.
+    degrees = new uint32_t[numberOfVertices];
+    for(uint32_t i = 0; i < numberOfVertices; ++i) {
+        degrees[i] = 0;
+        for(uint32_t column = 0, length = amountOfBitVectors(); column < length; ++column) {
+            degrees[i] += std::popcount(storage[i][column]);
+        }
+    }
+}
+
+void Graph2D::adoptWeights(const uint32_t* weights) {
+    vertexWeights = new uint32_t[numberOfVertices];
+    memcpy(vertexWeights, weights, numberOfVertices * sizeof(uint32_t));
+}
+
 uint32_t Graph2D::getDegree(uint32_t vertex) const {
     vertex -= GRAPH_OFFSET;
     /*uint32_t total = 0;
@@ -222,11 +243,18 @@ void LowerTriangularGraph::setParameters(uint32_t numberOfVertices, uint32_t num
     Graph::setParameters(numberOfVertices, numberOfEdges);
 
     // Calculate amount of needed bits
-    size_t amountOfBits = numberOfVertices * (numberOfVertices + 1) / 2;
+    size_t amountOfBits = (size_t) numberOfVertices * (numberOfVertices + 1) / 2;
 
     storage = new uint64_t[(amountOfBits + 64 - 1) / 64]();
 }
 
+void LowerTriangularGraph::adoptStorage(uint32_t numberOfVertices, uint32_t numberOfEdges, uint64_t** rows, std::shared_ptr<MappedFile> snapshot) {
+    Graph::setParameters(numberOfVertices, numberOfEdges);
+    this->snapshot = std::move(snapshot);
+    storage = rows[0];
+    delete[] rows;
+}
+
 Graph::StorageOffset ListGraph::ref(uint32_t from, uint32_t to) const {
     if(from < to) {
         return {
@@ -250,6 +278,12 @@ void ListGraph::setParameters(uint32_t numberOfVertices, uint32_t numberOfEdges)
     }
 }
 
+void ListGraph::adoptStorage(uint32_t numberOfVertices, uint32_t numberOfEdges, uint64_t** rows, std::shared_ptr<MappedFile> snapshot) {
+    Graph::setParameters(numberOfVertices, numberOfEdges);
+    this->snapshot = std::move(snapshot);
+    storage = rows;
+}
+
 std::unordered_set<std::pair<uint32_t, uint32_t>, pair_hash>& EdgeSetGraph::getEdges(){
     return edgeSet;
 }
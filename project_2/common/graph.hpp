@@ -6,12 +6,15 @@
 #define GRAPH_OFFSET 0
 #endif
 #include <cstdint>
+#include <cstddef>
+#include <memory>
 #include <unordered_set>
 #include <utility>
 
 template<typename T, size_t O>
 class OffsetArray;
 class DynamicBitSet;
+class MappedFile;
 
 class Graph {
 protected:
@@ -20,6 +23,9 @@ protected:
         uint64_t bit;
     };
 
+    // Keeps a memory mapped snapshot alive while the storage points into it, see graph_snapshot.hpp.
+    std::shared_ptr<MappedFile> snapshot;
+
 public:
     uint32_t numberOfVertices { 0 };
     uint32_t numberOfEdges { 0 };
@@ -55,10 +61,14 @@ protected:
     uint32_t* degrees {nullptr};
 
 public:
+    // Not the "2d" layout of project_1: that one has no weights, and both projects read the same test data.
+    static constexpr uint32_t snapshotLayout = 4;
+    static constexpr const char* snapshotName = "2dw";
+
     Graph2D() {}
     Graph2D(const Graph2D&);
     ~Graph2D() { 
-        for(uint32_t i = 0; i < numberOfVertices; ++i) {
+        for(uint32_t i = 0; i < numberOfVertices && !snapshot; ++i) {
             delete[] storage[i];
         }
 
@@ -89,6 +99,16 @@ public:
     inline uint32_t getWeight(uint32_t vertex) const {
         return vertexWeights[vertex - GRAPH_OFFSET];
     }
+
+    inline const uint32_t* weights() const {
+        return vertexWeights;
+    }
+
+    static uint32_t storageRows(uint32_t numberOfVertices) { return numberOfVertices; }
+    static size_t storageRowWords(uint32_t numberOfVertices, uint32_t) { return (numberOfVertices + 64 - 1) / 64; }
+    const uint64_t* storageRow(uint32_t row) const { return storage[row]; }
+    void adoptStorage(uint32_t numberOfVertices, uint32_t numberOfEdges, uint64_t** rows, std::shared_ptr<MappedFile> snapshot);
+    void adoptWeights(const uint32_t* weights);
 };
 
 class LowerTriangularGraph final : public Graph {
@@ -98,8 +118,20 @@ protected:
     uint64_t* storage {nullptr};
 
 public:
+    static constexpr uint32_t snapshotLayout = 2;
+    static constexpr const char* snapshotName = "lower";
+
     LowerTriangularGraph() {}
-    ~LowerTriangularGraph() { delete[] storage; }
+    ~LowerTriangularGraph() {
+        if(!snapshot) {
+            delete[] storage;
+        }
+    }
+
+    static uint32_t storageRows(uint32_t) { return 1; }
+    static size_t storageRowWords(uint32_t numberOfVertices, uint32_t) { return ((size_t) numberOfVertices * (numberOfVertices + 1) / 2 + 64 - 1) / 64; }
+    const uint64_t* storageRow(uint32_t) const { return storage; }
+    void adoptStorage(uint32_t numberOfVertices, uint32_t numberOfEdges, uint64_t** rows, std::shared_ptr<MappedFile> snapshot);
 
     void setParameters(uint32_t numberOfVertices, uint32_t numberOfEdges) override;
 };
@@ -111,15 +143,23 @@ protected:
     uint64_t** storage {nullptr};
 
 public:
+    static constexpr uint32_t snapshotLayout = 3;
+    static constexpr const char* snapshotName = "list";
+
     ListGraph() {}
     ~ListGraph() {
-        for(uint32_t i = 0; i < numberOfVertices; ++i) {
+        for(uint32_t i = 0; i < numberOfVertices && !snapshot; ++i) {
             delete[] storage[i];
         }
 
         delete[] storage;
     }
 
+    static uint32_t storageRows(uint32_t numberOfVertices) { return numberOfVertices; }
+    static size_t storageRowWords(uint32_t, uint32_t row) { return ((row + 1) + 64 - 1) / 64; }
+    const uint64_t* storageRow(uint32_t row) const { return storage[row]; }
+    void adoptStorage(uint32_t numberOfVertices, uint32_t numberOfEdges, uint64_t** rows, std::shared_ptr<MappedFile> snapshot);
+
     void setParameters(uint32_t numberOfVertices, uint32_t numberOfEdges) override;
 };
 
@@ -132,6 +172,7 @@ struct pair_hash
     }
 };
 
+// Can't be loaded from a snapshot, the edge set is only filled by addEdge.
 class EdgeSetGraph : public Graph2D {
 protected:
     std::unordered_set<std::pair<uint32_t, uint32_t>, pair_hash> edgeSet;
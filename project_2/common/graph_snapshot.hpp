@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <memory>
+#include <stdexcept>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <mapped_file.hpp>
+
+/**
+ * Binary snapshot of a parsed graph, stored next to the source file as "<file>.<layout>.snap".
+ *
+ * Layout of a snapshot file:
+ *   - a 64 byte header (see SnapshotHeader)
+ *   - the vertex weights as uint32_t, only for weighted graphs
+ *   - the rows of the storage backend, in the word format the backend uses in memory
+ * Every section and every row starts at a multiple of 64 bytes.
+ *
+ * Loading maps the file copy-on-write and points the graph storage straight into the mapping, so there is no
+ * per-edge work. Solvers that modify the graph (reordering, removing vertices) only touch their private copy
+ * of the pages they write.
+ *
+ * The graph type must provide snapshotLayout, snapshotName, storageRows(N), storageRowWords(N, row), storageRow(row)
+ * and adoptStorage(...). Weighted graphs additionally provide weights() and adoptWeights(...).
+ * Both projects read the same input files, so a layout id and name are never shared between a weighted and an
+ * unweighted graph type: project_1 uses 1 ("2d"), 2 ("lower") and 3 ("list"), the weighted Graph2D of project_2 uses
+ * 4 ("2dw").
+ */
+class GraphSnapshot final {
+public:
+    static constexpr char magic[8] = { 'C', 'L', 'Q', 'S', 'N', 'A', 'P', '\0' };
+    static constexpr uint32_t version = 1;
+    static constexpr size_t alignment = 64;
+
+    struct SnapshotHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t layout;
+        uint32_t numberOfVertices;
+        uint32_t numberOfEdges;
+        // Size and modification time (ns) of the source file, a snapshot is only used when both match.
+        uint64_t sourceSize;
+        int64_t sourceModificationTime;
+        uint64_t weightsOffset;
+        uint64_t storageOffset;
+        uint64_t fileSize;
+    };
+    static_assert(sizeof(SnapshotHeader) == alignment);
+
+    struct SourceInfo {
+        uint64_t size;
+        int64_t modificationTime;
+    };
+
+    static SourceInfo sourceInfo(const char* fileName) {
+        struct stat info;
+        if(stat(fileName, &info) != 0) {
+            throw std::runtime_error("Could not open source file");
+        }
+        return { (uint64_t) info.st_size, info.st_mtim.tv_sec * 1000000000L + info.st_mtim.tv_nsec };
+    }
+
+    template<typename G>
+    static std::string pathFor(const char* sourceFileName) {
+        return std::string(sourceFileName) + "." + G::snapshotName + ".snap";
+    }
+
+    /**
+     * @brief   Writes the graph to a snapshot file.
+     * @note    The file is written under a temporary name and renamed, so concurrent runs never see half a snapshot.
+     * @retval  Whether the snapshot could be written.
+     */
+    template<typename G>
+    static bool save(const char* fileName, const G& graph, SourceInfo source) {
+        SnapshotHeader header {};
+        memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.layout = G::snapshotLayout;
+        header.numberOfVertices = graph.numberOfVertices;
+        header.numberOfEdges = graph.numberOfEdges;
+        header.sourceSize = source.size;
+        header.sourceModificationTime = source.modificationTime;
+
+        size_t offset = alignment;
+        if constexpr(hasWeights<G>) {
+            header.weightsOffset = offset;
+            offset = align(offset + graph.numberOfVertices * sizeof(uint32_t));
+        }
+        header.storageOffset = offset;
+        const uint32_t rowCount = G::storageRows(graph.numberOfVertices);
+        for(uint32_t row = 0; row < rowCount; ++row) {
+            offset += align(G::storageRowWords(graph.numberOfVertices, row) * sizeof(uint64_t));
+        }
+        header.fileSize = offset;
+
+        std::string temporary = std::string(fileName) + ".tmp" + std::to_string(getpid());
+        FILE* out = fopen(temporary.c_str(), "wb");
+        if(out == nullptr) {
+            return false;
+        }
+
+        bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+        if constexpr(hasWeights<G>) {
+            ok = ok && write(out, graph.weights(), graph.numberOfVertices * sizeof(uint32_t));
+        }
+        for(uint32_t row = 0; ok && row < rowCount; ++row) {
+            ok = write(out, graph.storageRow(row), G::storageRowWords(graph.numberOfVertices, row) * sizeof(uint64_t));
+        }
+        ok = fclose(out) == 0 && ok;
+
+        if(!ok || rename(temporary.c_str(), fileName) != 0) {
+            unlink(temporary.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief   Loads a snapshot into an empty graph.
+     * @retval  Whether the snapshot was valid for this graph type and source file.
+     */
+    template<typename G>
+    static bool load(const char* fileName, G& graph, SourceInfo source) {
+        if(access(fileName, R_OK) != 0) {
+            return false;
+        }
+
+        auto file = std::make_shared<MappedFile>(fileName, true);
+        if(file->size() < sizeof(SnapshotHeader)) {
+            return false;
+        }
+
+        SnapshotHeader header;
+        memcpy(&header, file->begin(), sizeof(header));
+        if(memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version || header.layout != G::snapshotLayout
+            || header.sourceSize != source.size || header.sourceModificationTime != source.modificationTime
+            || header.fileSize != file->size() || hasWeights<G> != (header.weightsOffset != 0)) {
+            return false;
+        }
+
+        // The row pointers are the only thing that is built, every row already is in the backend's word format.
+        char* base = file->data();
+        const uint32_t rowCount = G::storageRows(header.numberOfVertices);
+        uint64_t** rows = new uint64_t*[rowCount];
+        size_t offset = header.storageOffset;
+        for(uint32_t row = 0; row < rowCount; ++row) {
+            rows[row] = reinterpret_cast<uint64_t*>(base + offset);
+            offset += align(G::storageRowWords(header.numberOfVertices, row) * sizeof(uint64_t));
+        }
+        if(offset != header.fileSize) {
+            delete[] rows;
+            return false;
+        }
+
+        graph.adoptStorage(header.numberOfVertices, header.numberOfEdges, rows, file);
+        if constexpr(hasWeights<G>) {
+            graph.adoptWeights(reinterpret_cast<const uint32_t*>(base + header.weightsOffset));
+        }
+        return true;
+    }
+
+private:
+    template<typename G>
+    static constexpr bool hasWeights = requires(const G& graph) { graph.weights(); };
+
+    static size_t align(size_t bytes) {
+        return (bytes + alignment - 1) / alignment * alignment;
+    }
+
+    static bool write(FILE* out, const void* data, size_t bytes) {
+        static const char padding[alignment] = {};
+        size_t padded = align(bytes);
+        return fwrite(data, 1, bytes, out) == bytes && fwrite(padding, 1, padded - bytes, out) == padded - bytes;
+    }
+};
+
+/**
+ * Loads graphs through their snapshot when there is a valid one, otherwise parses the source file with the
+ * given parser and writes a snapshot for the next run. Works as a drop-in replacement for the parser.
+ */
+template<typename Parser>
+class GraphCache final {
+public:
+    GraphCache() {}
+    GraphCache(const GraphCache&) = delete;
+    ~GraphCache() {}
+
+    template<typename G>
+    void load(const char& fileName, G& graph) const {
+        auto source = GraphSnapshot::sourceInfo(&fileName);
+        std::string snapshotPath = GraphSnapshot::pathFor<G>(&fileName);
+
+        if(GraphSnapshot::load(snapshotPath.c_str(), graph, source)) {
+            return;
+        }
+
+        Parser parser;
+        parser.parse(fileName, graph);
+
+        // Failing to write the cache (e.g. read-only data directory) is not an error, the next run just parses again.
+        GraphSnapshot::save(snapshotPath.c_str(), graph, source);
+    }
+};
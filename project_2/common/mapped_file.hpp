@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * View of a whole file, backed by mmap so nothing is copied.
+ * A copy-on-write mapping can be written to, the changes are private to this process and never reach the file.
+ */
+class MappedFile final {
+public:
+    MappedFile(const char* fileName, bool copyOnWrite = false) {
+        int fd = open(fileName, O_RDONLY);
+        if(fd < 0) {
+            throw std::runtime_error("Could not open source file");
+        }
+
+        struct stat info;
+        if(fstat(fd, &info) != 0) {
+            close(fd);
+            throw std::runtime_error("Could not stat source file");
+        }
+
+        length = info.st_size;
+
+        // mmap does not accept empty mappings.
+        if(length > 0) {
+            void* mapping = mmap(nullptr, length, copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mapping == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Could not map source file");
+            }
+            storage = static_cast<char*>(mapping);
+            madvise(mapping, length, copyOnWrite ? MADV_WILLNEED : MADV_SEQUENTIAL);
+        }
+
+        // The mapping stays valid after closing the descriptor.
+        close(fd);
+    }
+
+    MappedFile(MappedFile&& other) noexcept
+        : storage(std::exchange(other.storage, nullptr)), length(std::exchange(other.length, 0)) {}
+
+    MappedFile(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if(storage != nullptr) {
+            munmap(storage, length);
+        }
+    }
+
+    char* data() {
+        return storage;
+    }
+
+    const char* begin() const {
+        return storage;
+    }
+
+    const char* end() const {
+        return storage + length;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+private:
+    char* storage { nullptr };
+    size_t length { 0 };
+};
@@ -17,6 +17,9 @@ public:
     OffsetArray(OffsetArray&& other) noexcept : storage(std::exchange(other.storage, nullptr)) {}
 
     OffsetArray& operator=(OffsetArray&& other) {
+        if(storage != nullptr) {
+            delete[] (storage + O);
+        }
         storage = std::exchange(other.storage, nullptr);
         return *this;
     }